@@ -0,0 +1,97 @@
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "log4cplus/filter.h"
+#include "log4cplus/loggingevent.h"
+#include "log4cplus/stringhelper.h"
+#include "log4cplus/timehelper.h"
+
+using namespace std;
+using namespace log4cplus;
+
+// Micro benchmark for the message matching filters. It compares a naive
+// std::string::find() with the precompiled StringSearcher and measures the
+// StringMatchFilter and RegexFilter decide() cost on the same messages.
+
+static const int ITERATIONS = 200000;
+
+static double elapsedMicros(const TimeHelper& start)
+{
+	TimeHelper const diff = TimeHelper::gettimeofday() - start;
+	return static_cast<double>(diff.sec()) * 1000000.0 + diff.usec();
+}
+
+static void report(const char* name, double micros, size_t hits)
+{
+	cout << name << ": " << (micros * 1000.0 / ITERATIONS) << " ns/op"
+		<< " (" << hits << " hits)" << endl;
+}
+
+int main()
+{
+	vector<string> messages;
+	messages.push_back("connection from 10.0.0.1 accepted");
+	messages.push_back("request /index.html served in 12 ms");
+	messages.push_back(string(200, 'x') + " timeout while waiting for upstream " + string(200, 'y'));
+	messages.push_back(string(1000, 'a') + "b");
+
+	// English text where the first byte of the needle is frequent; this is
+	// where a first-byte memchr() scan degrades.
+	string text;
+	for(int i = 0; i < 40; ++i)
+		text += "the total time taken to transmit the text ";
+	messages.push_back(text + "timeout");
+
+	string const needle("timeout");
+	size_t hits;
+
+	hits = 0;
+	TimeHelper start = TimeHelper::gettimeofday();
+	for(int i = 0; i < ITERATIONS; ++i)
+	{
+		if(messages[i % messages.size()].find(needle) != string::npos)
+			++hits;
+	}
+	report("std::string::find", elapsedMicros(start), hits);
+
+	StringSearcher searcher(needle);
+	hits = 0;
+	start = TimeHelper::gettimeofday();
+	for(int i = 0; i < ITERATIONS; ++i)
+	{
+		if(searcher.find(messages[i % messages.size()]) != string::npos)
+			++hits;
+	}
+	report("StringSearcher::find", elapsedMicros(start), hits);
+
+	vector<InternalLoggingEvent*> events;
+	for(size_t i = 0; i < messages.size(); ++i)
+		events.push_back(new InternalLoggingEvent("bench", INFO_LOG_LEVEL, messages[i]));
+
+	StringMatchFilter stringFilter(needle);
+	hits = 0;
+	start = TimeHelper::gettimeofday();
+	for(int i = 0; i < ITERATIONS; ++i)
+	{
+		if(stringFilter.decide(*events[i % events.size()]) == ACCEPT)
+			++hits;
+	}
+	report("StringMatchFilter::decide", elapsedMicros(start), hits);
+
+	RegexFilter regexFilter("time(out)? while");
+	hits = 0;
+	start = TimeHelper::gettimeofday();
+	for(int i = 0; i < ITERATIONS; ++i)
+	{
+		if(regexFilter.decide(*events[i % events.size()]) == ACCEPT)
+			++hits;
+	}
+	report("RegexFilter::decide", elapsedMicros(start), hits);
+
+	for(size_t i = 0; i < events.size(); ++i)
+		delete events[i];
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "log4cplus/fileappender.h"
+#include "log4cplus/layout.h"
+#include "log4cplus/sharedmemoryappender.h"
+
+using namespace std;
+using namespace log4cplus;
+
+// Collector for SharedMemoryAppender: merges the events of all worker
+// processes configured with the same Name into one rolling file.
+//
+//   shm_collector <name> <file> [maxFileSize] [maxBackupIndex]
+//
+// Workers use for example:
+//
+//   log4cplus.appender.SHM=SharedMemoryAppender
+//   log4cplus.appender.SHM.Name=<name>
+//   log4cplus.appender.SHM.layout=PatternLayout
+//   log4cplus.appender.SHM.layout.ConversionPattern=%D %p %c - %m%n
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int)
+{
+	s_stop = 1;
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc < 3 || argc > 5)
+	{
+		cerr << "usage: shm_collector <name> <file> [maxFileSize] [maxBackupIndex]" << endl;
+		return 1;
+	}
+
+	long const maxFileSize = argc > 3 ? atol(argv[3]) : 10 * 1024 * 1024;
+	int const maxBackupIndex = argc > 4 ? atoi(argv[4]) : 5;
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, 0);
+	sigaction(SIGTERM, &sa, 0);
+
+	// The workers formatted the events already.
+	SharedAppenderPtr file(new RollingFileAppender(argv[2], maxFileSize, maxBackupIndex, false));
+	file->setLayout(std::auto_ptr<Layout>(new PatternLayout("%m")));
+
+	SharedMemoryCollector collector(argv[1], file);
+	while(!s_stop)
+	{
+		if(collector.poll() == 0)
+		{
+			file->flush();
+			usleep(100 * 1000);
+		}
+	}
+
+	collector.poll();
+	file->close();
+
+	cerr << "events dropped by workers: " << collector.getDroppedCount() << endl;
+	return 0;
+}
@@ -0,0 +1,124 @@
+
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <signal.h>
+
+using namespace std;
+
+// Stand-in for a syslog daemon or collector to test SocketAppender
+// against. It prints every datagram, or every line of every stream
+// connection, it receives on stdout.
+//
+//   socket_receiver unix-dgram <path>
+//   socket_receiver unix-stream <path>
+//   socket_receiver udp <port>
+
+static volatile sig_atomic_t s_stop = 0;
+
+static void onSignal(int)
+{
+	s_stop = 1;
+}
+
+static int usage()
+{
+	cerr << "usage: socket_receiver unix-dgram|unix-stream <path>" << endl
+		<< "       socket_receiver udp <port>" << endl;
+	return 1;
+}
+
+static void serveDatagrams(int fd)
+{
+	char buf[65536];
+	while(!s_stop)
+	{
+		ssize_t const n = recv(fd, buf, sizeof(buf), 0);
+		if(n < 0)
+			break;
+		cout << string(buf, n) << endl;
+	}
+}
+
+static void serveStreams(int fd)
+{
+	char buf[4096];
+	while(!s_stop)
+	{
+		int const client = accept(fd, 0, 0);
+		if(client < 0)
+			break;
+
+		ssize_t n;
+		while((n = recv(client, buf, sizeof(buf), 0)) > 0)
+			cout.write(buf, n);
+		cout.flush();
+		close(client);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if(argc != 3)
+		return usage();
+
+	string const protocol(argv[1]);
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = onSignal;
+	sigaction(SIGINT, &sa, 0);
+	sigaction(SIGTERM, &sa, 0);
+
+	int fd = -1;
+	if(protocol == "udp")
+	{
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(static_cast<unsigned short>(atoi(argv[2])));
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if(fd < 0 || bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+		{
+			perror("bind");
+			return 1;
+		}
+		serveDatagrams(fd);
+	}
+	else if(protocol == "unix-dgram" || protocol == "unix-stream")
+	{
+		bool const isStream = protocol == "unix-stream";
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strncpy(addr.sun_path, argv[2], sizeof(addr.sun_path) - 1);
+
+		unlink(argv[2]);
+		fd = socket(AF_UNIX, isStream ? SOCK_STREAM : SOCK_DGRAM, 0);
+		if(fd < 0 || bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0
+			|| (isStream && listen(fd, 4) != 0))
+		{
+			perror("bind");
+			return 1;
+		}
+
+		if(isStream)
+			serveStreams(fd);
+		else
+			serveDatagrams(fd);
+		unlink(argv[2]);
+	}
+	else
+		return usage();
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,101 @@
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "log4cplus/logger.h"
+#include "log4cplus/fileappender.h"
+#include "log4cplus/layout.h"
+#include "log4cplus/loggingmacros.h"
+#include "log4cplus/mutex.h"
+#include "log4cplus/stringhelper.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/timehelper.h"
+
+using namespace std;
+using namespace log4cplus;
+
+// Benchmark for FileAppender's WriteCombining mode. N threads log to one
+// file appender, first under the appender lock for every event, then
+// through per-thread buffers. The lock counts per run are only reported
+// when the library is built with LOG4CPLUS_MUTEX_STATS.
+//
+// Usage: writecombine_benchmark [threads] [events per thread]
+
+static int s_eventsPerThread = 200000;
+
+class LoggingThread : public Thread
+{
+public:
+	explicit LoggingThread(int id) : _id(id) {}
+
+protected:
+	virtual void run()
+	{
+		Logger logger = Logger::getInstance("bench");
+		string const prefix = "thread " + convertIntegerToString(_id) + " event ";
+		for(int i = 0; i < s_eventsPerThread; ++i)
+			LOG4CPLUS_INFO(logger, prefix + convertIntegerToString(i));
+	}
+
+private:
+	int _id;
+};
+
+static double runThreads(int threadCount)
+{
+	vector<LoggingThread*> threads;
+	for(int i = 0; i < threadCount; ++i)
+		threads.push_back(new LoggingThread(i));
+
+	TimeHelper const start = TimeHelper::gettimeofday();
+	for(int i = 0; i < threadCount; ++i)
+		threads[i]->start();
+	for(int i = 0; i < threadCount; ++i)
+	{
+		threads[i]->join();
+		delete threads[i];
+	}
+
+	TimeHelper const diff = TimeHelper::gettimeofday() - start;
+	return static_cast<double>(diff.sec()) + diff.usec() / 1000000.0;
+}
+
+static void runMode(const char* name, const char* fileName, int threadCount, bool writeCombining)
+{
+	FileAppender* appender = new FileAppender(fileName, std::ios_base::trunc, false);
+	appender->setLayout(std::auto_ptr<Layout>(new PatternLayout("%D{%H:%M:%S} [%t] %-5p %c - %m%n")));
+	if(writeCombining)
+		appender->setWriteCombining(65536, 200);
+
+	SharedAppenderPtr const appenderPtr(appender);
+	Logger::getRoot().addAppender(appenderPtr);
+	Logger::getRoot().setLogLevel(INFO_LOG_LEVEL);
+
+	Mutex::resetStats();
+	double const seconds = runThreads(threadCount);
+
+	// Writes out what the threads left in their buffers.
+	appender->close();
+	Logger::getRoot().removeAllAppenders();
+	double const events = static_cast<double>(threadCount) * s_eventsPerThread;
+
+	cout << name << ": " << threadCount << " threads, " << (events / seconds) << " events/s" << endl;
+	Mutex::dumpStats(cout);
+	cout << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	int threadCount = 8;
+	if(argc > 1)
+		threadCount = atoi(argv[1]);
+	if(argc > 2)
+		s_eventsPerThread = atoi(argv[2]);
+
+	runMode("locked", "writecombine_benchmark_locked.log", threadCount, false);
+	runMode("write combining", "writecombine_benchmark_combined.log", threadCount, true);
+
+	return 0;
+}
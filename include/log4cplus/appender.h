@@ -76,6 +76,12 @@ public:
         */
     virtual void close() = 0;
 
+    /**
+        * Writes out output the appender still buffers. The default
+        * implementation does nothing.
+        */
+    virtual void flush();
+
     /**
         * Check if this appender is in closed state.
         */
@@ -125,10 +131,22 @@ public:
         */
     virtual Layout* getLayout();
 
+    /**
+        * Id shared with the appenders whose layouts format events the
+        * same way, see getLayoutShareId(); 0 if the layout shares with
+        * no other.
+        */
+    unsigned int getLayoutShareId() const { return _layoutShareId; }
+
     /**
         * Set the filter chain on this Appender.
+        *
+        * When every filter in the chain decides on the LogLevel alone
+        * (see Filter::decideLevel()), the verdict for each LogLevel is
+        * computed here and doAppend() only looks it up. Call setFilter()
+        * again after changing a chain that is already set.
         */
-    void setFilter(FilterPtr f) { _filter = f; }
+    void setFilter(FilterPtr f);
 
     /**
         * Get the filter chain on this Appender.
@@ -169,12 +187,44 @@ protected:
         */
     virtual void append(const InternalLoggingEvent& loggingEvent) = 0;
 
+    /**
+        * Called by doAppend() without _mutex held when
+        * _isAppendUnlocked is set and the filter chain, if any, is made
+        * of LogLevel filters only; the appender synchronizes on its own.
+        * The default implementation locks _mutex and calls append().
+        */
+    virtual void appendUnlocked(const InternalLoggingEvent& loggingEvent);
+
+    /**
+        * Appends the events the filter chain has queued on its own,
+        * see Filter::nextPendingEvent().
+        */
+    void appendPendingEvents();
+
+    /**
+        * Fills _levelVerdicts if the filter chain is made of LogLevel
+        * filters only.
+        */
+    void compileFilter();
+
+    /**
+        * Formats the event with the layout and returns the text. During
+        * a dispatch where other appenders have an equivalent layout, the
+        * first of them formats the event and the others get the same
+        * text; otherwise the event is formatted into a buffer of this
+        * appender, valid until the next call.
+        */
+    const std::string& formatEvent(const InternalLoggingEvent& loggingEvent);
+
 
     
     /** The layout variable does not need to be set if the appender
         *  implementation has its own layout. */
     std::auto_ptr<Layout> _layout;
 
+    /** getLayoutShareId() of _layout. */
+    unsigned int _layoutShareId;
+
     /** Appenders are named. */
     std::string _name;
 
@@ -185,12 +235,28 @@ protected:
         *  initially. */
     FilterPtr _filter;
 
+    /** Number of entries in _levelVerdicts, one per LogLevel step of
+        *  10000 from 0 up to OFF_LOG_LEVEL. */
+    enum { LEVEL_VERDICTS = OFF_LOG_LEVEL / 10000 + 1 };
+
+    /** Verdict of the filter chain per LogLevel, valid when
+        *  _levelVerdictsValid is set. */
+    FilterResult _levelVerdicts[LEVEL_VERDICTS];
+    bool _levelVerdictsValid;
+
     /** It is assumed and enforced that errorHandler is never null. */
     std::auto_ptr<ErrorHandler> _errorHandler;
 
     /** Is this appender closed? */
     bool _isClosed;
+
+    /** Set by appenders implementing appendUnlocked(). */
+    bool _isAppendUnlocked;
 	Mutex _mutex;
+
+private:
+    std::string _formatBuffer;
+    StringByteSink _formatSink;
 };
 
 /** This is a pointer to an Appender. */
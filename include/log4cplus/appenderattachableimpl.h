@@ -9,6 +9,7 @@
 #include "log4cplus/sharedptr.h"
 #include "log4cplus/appenderattachable.h"
 #include "log4cplus/mutex.h"
+#include "log4cplus/atomic.h"
 
 #include <memory>
 #include <vector>
@@ -67,11 +68,35 @@ public:
 	*/
 	virtual void removeAppender(const std::string& name);
 
+	/**
+	* Replaces the list of appenders with <code>appenders</code> in a
+	* single step, so that concurrent logging sees either the old or the
+	* new list and never an empty one.
+	*/
+	virtual void setAppenders(const SharedAppenderPtrList& appenders);
+
 	/**
 	* Call the <code>doAppend</code> method on all attached appenders.  
 	*/
 	int appendLoopOnAppenders(const InternalLoggingEvent& loggingEvent) const;
 
+	/**
+	* Number of changes made so far to any appender list, or to anything
+	* else deciding which appenders a logger uses (see notifyChange()).
+	* Loggers compare it with the value their flattened appender set was
+	* built at.
+	*/
+	static AtomicInt getChangeCount()
+	{
+		return s_changeCount;
+	}
+
+	//! Makes the loggers build their flattened appender sets again.
+	static void notifyChange()
+	{
+		atomicIncrement(&s_changeCount);
+	}
+
 protected:
 	// Types
 	typedef std::vector<SharedAppenderPtr> ListType;
@@ -81,6 +106,8 @@ protected:
 	ListType _appenderList;
 
 private:
+	static volatile AtomicInt s_changeCount;
+
 	AppenderAttachableImpl(AppenderAttachableImpl const&);
 	AppenderAttachableImpl & operator = (AppenderAttachableImpl const&);
 };  // end class AppenderAttachableImpl
@@ -0,0 +1,113 @@
+// Module:  Log4CPLUS
+// File:    atomic.h
+
+#ifndef LOG4CPLUS_ATOMIC_H_
+#define LOG4CPLUS_ATOMIC_H_
+
+#include "log4cplus/platform.h"
+
+
+namespace log4cplus {
+
+
+#ifdef _MSC_VER
+	typedef LONG AtomicInt;
+	typedef LONGLONG AtomicInt64;
+#else	//__linux__
+	typedef long AtomicInt;
+	typedef long long AtomicInt64;
+#endif
+
+
+/**
+* Minimal set of full-barrier atomic operations used on the hot logging
+* path, implemented with the Interlocked API on Windows and the gcc
+* __sync builtins on Linux.
+*/
+
+inline AtomicInt atomicIncrement(volatile AtomicInt* p)
+{
+#ifdef _MSC_VER
+	return InterlockedIncrement(p);
+#else
+	return __sync_add_and_fetch(p, 1);
+#endif
+}
+
+inline AtomicInt atomicDecrement(volatile AtomicInt* p)
+{
+#ifdef _MSC_VER
+	return InterlockedDecrement(p);
+#else
+	return __sync_sub_and_fetch(p, 1);
+#endif
+}
+
+inline AtomicInt atomicExchange(volatile AtomicInt* p, AtomicInt value)
+{
+#ifdef _MSC_VER
+	return InterlockedExchange(p, value);
+#else
+	return __sync_lock_test_and_set(p, value);
+#endif
+}
+
+//! Returns the previous value of <code>*p</code>.
+inline AtomicInt atomicCompareExchange(volatile AtomicInt* p, AtomicInt expected, AtomicInt value)
+{
+#ifdef _MSC_VER
+	return InterlockedCompareExchange(p, value, expected);
+#else
+	return __sync_val_compare_and_swap(p, expected, value);
+#endif
+}
+
+//! Returns the previous value of <code>*p</code>.
+template<class T>
+inline T* atomicCompareExchangePointer(T* volatile* p, T* expected, T* value)
+{
+#ifdef _MSC_VER
+	return static_cast<T*>(InterlockedCompareExchangePointer(
+		reinterpret_cast<PVOID volatile*>(p), value, expected));
+#else
+	return __sync_val_compare_and_swap(p, expected, value);
+#endif
+}
+
+inline AtomicInt64 atomicAdd64(volatile AtomicInt64* p, AtomicInt64 value)
+{
+#ifdef _MSC_VER
+	return InterlockedExchangeAdd64(p, value) + value;
+#else
+	return __sync_add_and_fetch(p, value);
+#endif
+}
+
+//! Returns the previous value of <code>*p</code>.
+inline AtomicInt64 atomicCompareExchange64(volatile AtomicInt64* p, AtomicInt64 expected, AtomicInt64 value)
+{
+#ifdef _MSC_VER
+	return InterlockedCompareExchange64(p, value, expected);
+#else
+	return __sync_val_compare_and_swap(p, expected, value);
+#endif
+}
+
+//! 64-bit loads are not atomic on 32-bit targets, so go through a CAS.
+inline AtomicInt64 atomicLoad64(volatile AtomicInt64* p)
+{
+	return atomicCompareExchange64(p, 0, 0);
+}
+
+inline void atomicStore64(volatile AtomicInt64* p, AtomicInt64 value)
+{
+	AtomicInt64 seen = atomicLoad64(p);
+	AtomicInt64 prev;
+	while((prev = atomicCompareExchange64(p, seen, value)) != seen)
+		seen = prev;
+}
+
+
+}  // namespace log4cplus
+
+#endif  // LOG4CPLUS_ATOMIC_H_
@@ -0,0 +1,139 @@
+// Module:  Log4CPLUS
+// File:    bytesink.h
+
+#ifndef LOG4CPLUS_BYTE_SINK_HEADER_
+#define LOG4CPLUS_BYTE_SINK_HEADER_
+
+#include "log4cplus/platform.h"
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+/**
+* Where a Layout writes the text of an event: a plain sequence of
+* bytes, with none of the formatting state, locale and virtual calls per
+* character of <code>std::ostream</code>.
+*
+* Besides append(), a writer that knows an upper bound of what it is
+* about to write can reserve() room for it, fill the room in place and
+* commit() the bytes it actually wrote, e.g. when rendering a number.
+*/
+class LOG4CPLUS_EXPORT ByteSink
+{
+public:
+	ByteSink();
+	virtual ~ByteSink();
+
+	virtual void append(const char* data, std::size_t length) = 0;
+
+	void append(const std::string& text)
+	{
+		append(text.data(), text.size());
+	}
+
+	void append(char c)
+	{
+		append(&c, 1);
+	}
+
+	/**
+	* Returns room for <code>length</code> bytes, valid until the next
+	* call on the sink. The default implementation hands out a buffer of
+	* its own, appended by commit().
+	*/
+	virtual char* reserve(std::size_t length);
+
+	//! Keeps the first <code>length</code> bytes of the room reserve() returned.
+	virtual void commit(std::size_t length);
+
+private:
+	std::vector<char> _reserved;
+
+	// Disallow copying of instances of this class
+	ByteSink(const ByteSink&);
+	ByteSink& operator= (const ByteSink&);
+};
+
+
+/**
+* Appends to a string, e.g. the buffer an appender writes from in one
+* piece. reserve() grows the string and commit() cuts it back, so
+* nothing is copied twice.
+*/
+class LOG4CPLUS_EXPORT StringByteSink : public ByteSink
+{
+public:
+	explicit StringByteSink(std::string* target = NULL);
+	virtual ~StringByteSink();
+
+	void setTarget(std::string* target)
+	{
+		_target = target;
+	}
+
+	virtual void append(const char* data, std::size_t length);
+	virtual char* reserve(std::size_t length);
+	virtual void commit(std::size_t length);
+
+private:
+	std::string* _target;
+	std::size_t _reservedAt;
+};
+
+
+/**
+* Writes to an <code>std::ostream</code>, for callers of the
+* <code>std::ostream</code> interface of the layouts.
+*/
+class LOG4CPLUS_EXPORT OStreamByteSink : public ByteSink
+{
+public:
+	explicit OStreamByteSink(std::ostream& output);
+	virtual ~OStreamByteSink();
+
+	virtual void append(const char* data, std::size_t length);
+
+private:
+	std::ostream& _output;
+};
+
+
+/**
+* An <code>std::ostream</code> writing to a ByteSink, for layouts that
+* only implement Layout::formatAndAppend(std::ostream&, ...). The stream
+* can be pointed at another sink, so it is built once per layout.
+*/
+class LOG4CPLUS_EXPORT ByteSinkStream : public std::ostream
+{
+public:
+	explicit ByteSinkStream(ByteSink* sink = NULL);
+	virtual ~ByteSinkStream();
+
+	void setSink(ByteSink* sink);
+
+private:
+	class Buffer : public std::streambuf
+	{
+	public:
+		Buffer() : _sink(NULL) {}
+
+		ByteSink* _sink;
+
+	protected:
+		virtual int_type overflow(int_type c);
+		virtual std::streamsize xsputn(const char* s, std::streamsize n);
+	};
+
+	Buffer _buffer;
+};
+
+
+} // namespace log4cplus
+
+#endif // LOG4CPLUS_BYTE_SINK_HEADER_
@@ -11,6 +11,7 @@
 #include "log4cplus/logger.h"
 #include "log4cplus/sharedptr.h"
 #include "log4cplus/property.h"
+#include "log4cplus/thread.h"
 
 #include <map>
 #include <vector>
@@ -50,6 +51,18 @@ public:
         * <code>doConfigure</code>.
         */
     virtual void configure();
+
+    /**
+        * Applies this configuration on top of the one described by
+        * <code>previous</code> (the getProperties() of the configurator
+        * used last). Appenders whose properties did not change are kept
+        * open, every other appender of the previous configuration is
+        * closed, LogLevels are updated in place and each logger's
+        * appender list is swapped in a single step. Loggers that are no
+        * longer configured are reset to INHERITED without appenders, and
+        * to additive when their <code>additivity</code> entry is gone.
+        */
+    void reconfigure(const Properties& previous);
     Properties const& getProperties() const;
     std::string const& getPropertyFilename() const;
 	static std::vector<std::string>& getLoggerNames() { return _loggerNames; }
@@ -58,14 +71,22 @@ protected:
     void init();  // called by the ctor
     void configureLoggers();
     void configureLogger(Logger logger, const std::string& config);
+    void configureAdditivity();
     void configureAppenders();
-        
-    virtual Logger getLogger(const std::string& name);
-    virtual void addAppender(Logger &logger, SharedAppenderPtr& appender);
 
     // Types
     typedef std::map<std::string, SharedAppenderPtr> AppenderMap;
 
+    /**
+        * Like configureAppenders(), but takes the appender from
+        * <code>reusable</code> when its properties are the same in
+        * <code>previous</code>.
+        */
+    void configureAppenders(const Properties& previous, const AppenderMap& reusable);
+    SharedAppenderPtr createAppender(const std::string& name, const Properties& appenderProperties);
+        
+    virtual Logger getLogger(const std::string& name);
+
       
     Hierarchy& _hierarchy;
     std::string _propertyFilename;
@@ -114,6 +135,40 @@ private:
 };
    
 
+/**
+    * Configures log4cplus from a properties file and keeps watching it.
+    * A background thread checks the modification time and size of the
+    * file every <code>millis</code> milliseconds and applies a changed
+    * file with PropertyConfigurator::reconfigure(), so unchanged
+    * appenders stay open and logging threads never see a logger without
+    * its appenders. The thread is stopped by the destructor.
+    */
+class LOG4CPLUS_EXPORT ConfigureAndWatchThread : private Thread
+{
+public:
+    ConfigureAndWatchThread(const std::string& propertyFile, unsigned int millis = 60 * 1000,
+        Hierarchy& h = Logger::getDefaultHierarchy());
+    virtual ~ConfigureAndWatchThread();
+
+private:
+    virtual void run();
+    bool checkForFileModification();
+    void updateLastModInfo();
+
+    std::string _propertyFile;
+    unsigned int _millis;
+    Hierarchy& _hierarchy;
+    Properties _properties;
+    time_t _lastModTime;
+    long long _lastFileSize;
+    ManualResetEvent _stopEvent;
+
+    // Disable copy
+    ConfigureAndWatchThread(const ConfigureAndWatchThread&);
+    ConfigureAndWatchThread& operator=(ConfigureAndWatchThread&);
+};
+
+
 } // namespace log4cplus
 
 
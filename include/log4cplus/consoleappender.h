@@ -14,11 +14,27 @@
 namespace log4cplus {
 
 
+class ConsoleWriter;
+
+
 /**
     * ConsoleAppender appends log events to <code>std::cout</code> or
     * <code>std::cerr</code> using a layout specified by the
     * user. The default target is <code>std::cout</code>.
     *
+    * With <b>DirectWrite</b> the appender bypasses iostreams: events
+    * are collected in a buffer shared by all ConsoleAppenders writing to
+    * the same descriptor and written with <code>write(2)</code> to file
+    * descriptor 1 or 2, once the buffer holds <b>BufferSize</b> bytes or
+    * at the latest <b>FlushInterval</b> milliseconds after the event.
+    * Each event is written whole, so events of concurrent appenders do not
+    * interleave. When the descriptor is a non-blocking pipe that is full,
+    * the events stay buffered; once four times <b>BufferSize</b> is
+    * pending, logging waits for the pipe rather than dropping events.
+    * The buffers are written out by flush(), close() and at exit().
+    * Output written to <code>std::cout</code> by other code is not
+    * ordered with these writes.
+    *
     * <h3>Properties</h3>
     * <dl>
     * <dt><tt>logToStdErr</tt></dt>
@@ -28,6 +44,17 @@ namespace log4cplus {
     * <dt><tt>ImmediateFlush</tt></dt>
     * <dd>When it is set true, output stream will be flushed after
     * each appended loggingEvent.</dd>
+    *
+    * <dt><tt>DirectWrite</tt></dt>
+    * <dd>When it is set true, events are written to the descriptor as
+    * described above. Not supported on Windows, where it is ignored.</dd>
+    *
+    * <dt><tt>BufferSize</tt></dt>
+    * <dd>Bytes collected before writing, 65536 by default.</dd>
+    *
+    * <dt><tt>FlushInterval</tt></dt>
+    * <dd>Most milliseconds an event waits in the buffer, 100 by
+    * default.</dd>
     * 
     * </dl>
     * \sa Appender
@@ -37,11 +64,20 @@ class LOG4CPLUS_EXPORT ConsoleAppender : public Appender
 public:
     ConsoleAppender(bool immediateFlush = false);
 
+    ConsoleAppender(bool logToStdErr, bool immediateFlush);
+
     ConsoleAppender(const Properties & properties);
 
     ~ConsoleAppender();
 
     virtual void close();
+    virtual void flush();
+
+    /**
+        * Switches to writing to the descriptor, see DirectWrite. Call
+        * before the first event is appended.
+        */
+    void setDirectWrite(std::size_t bufferSize, unsigned long flushMillis);
 
 protected:
     virtual void append(const InternalLoggingEvent& loggingEvent);
@@ -51,6 +87,12 @@ protected:
         * will be flushed at the end of each append operation.
         */
     bool _immediateFlush;
+
+    /** Standard error rather than standard output. */
+    bool _logToStdErr;
+
+    /** The shared buffer of the descriptor in DirectWrite mode. */
+    ConsoleWriter* _writer;
 };
 
 } // namespace log4cplus
@@ -0,0 +1,95 @@
+// Module:  Log4CPLUS
+// File:    controlserver.h
+
+#ifndef LOG4CPLUS_CONTROL_SERVER_HEADER_
+#define LOG4CPLUS_CONTROL_SERVER_HEADER_
+
+
+#include "log4cplus/platform.h"
+#include "log4cplus/logger.h"
+#include "log4cplus/loglevel.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/timehelper.h"
+
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+class Hierarchy;
+
+
+/**
+* Lets LogLevels be inspected and changed at runtime through a local
+* Unix domain stream socket, without reloading the configuration. Each
+* connection sends one command per line and gets the reply back:
+*
+* <dl>
+* <dt><code>set-level &lt;logger&gt; &lt;LEVEL&gt; [seconds]</code></dt>
+* <dd>Sets the LogLevel of the logger (<code>root</code> for the root
+* logger; <code>INHERITED</code> unsets it). With <code>seconds</code>
+* the previous LogLevel is restored after that many seconds.</dd>
+* <dt><code>get-levels</code></dt>
+* <dd>Lists every logger with its assigned and effective LogLevel.</dd>
+* <dt><code>stats</code></dt>
+* <dd>Writes Mutex::dumpStats().</dd>
+* <dt><code>flush</code></dt>
+* <dd>Calls Appender::flush() on all appenders.</dd>
+* </dl>
+*
+* Replies end with a line reading <code>OK</code> or starting with
+* <code>ERROR</code>. The server runs on its own thread from the
+* constructor until the destructor; it is not available on Windows.
+*/
+class LOG4CPLUS_EXPORT ControlServer : private Thread
+{
+public:
+	ControlServer(const std::string& socketPath, Hierarchy& h = Logger::getDefaultHierarchy());
+	virtual ~ControlServer();
+
+	//! <code>false</code> if the socket could not be set up.
+	bool isListening() const { return _listenFd >= 0; }
+
+	/**
+	* Executes a single command line and returns the reply. Used by the
+	* server thread, exposed for embedding the commands elsewhere.
+	*/
+	std::string execute(const std::string& command);
+
+private:
+	struct PendingRevert
+	{
+		std::string logger;
+		LogLevel level;
+		TimeHelper deadline;
+	};
+
+	virtual void run();
+	void serveClient(int fd);
+	void revertExpiredLevels();
+	int millisToNextRevert() const;
+	Logger getLogger(const std::string& name);
+
+	std::string setLevel(const std::vector<std::string>& args);
+	std::string getLevels();
+	std::string stats();
+	std::string flush();
+
+	std::string _socketPath;
+	Hierarchy& _hierarchy;
+	int _listenFd;
+	int _wakeupPipe[2];
+	std::vector<PendingRevert> _reverts;
+
+	// Disable copy
+	ControlServer(const ControlServer&);
+	ControlServer& operator=(const ControlServer&);
+};
+
+
+} // namespace log4cplus
+
+
+#endif // LOG4CPLUS_CONTROL_SERVER_HEADER_
@@ -6,18 +6,74 @@
 
 #include "log4cplus/platform.h"
 #include "log4cplus/appender.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/atomic.h"
+
+#include <string>
+#include <vector>
 
 #ifdef WIN32
-typedef void (__stdcall *pCustomFuncCallBack)(const char*);
+#define LOG4CPLUS_CUSTOM_CALLBACK __stdcall
 #else
-typedef void (*pCustomFuncCallBack)(const char*);
-#endif	
+#define LOG4CPLUS_CUSTOM_CALLBACK
+#endif
+
+typedef void (LOG4CPLUS_CUSTOM_CALLBACK *pCustomFuncCallBack)(const char*);
+
+
+/**
+* One formatted event handed to a CustomAppender callback. The text is
+* the layout output without the terminating NUL SimpleLayout writes;
+* neither string is NUL terminated.
+*/
+struct CustomLogSpan
+{
+	int logLevel;
+	const char* logger;
+	size_t loggerLength;
+	const char* text;
+	size_t length;
+};
+
+//! Receives each event in the logging thread.
+typedef void (LOG4CPLUS_CUSTOM_CALLBACK *pCustomEventCallBack)(void* userData, const CustomLogSpan* span);
+
+//! Receives the queued events in order, from the drain thread.
+typedef void (LOG4CPLUS_CUSTOM_CALLBACK *pCustomBatchCallBack)(void* userData, const CustomLogSpan* spans, size_t count);
 
 
 namespace log4cplus {
 
 
-class LOG4CPLUS_EXPORT CustomAppender : public Appender
+/**
+* Hands the formatted events to callbacks of the application.
+*
+* Callbacks are registered per appender name, before or after the
+* appender is configured; the first of these that is registered is used:
+* <ol>
+* <li>A batch callback (setBatchCallBack()): append() copies the event
+* into a queue and returns; a thread drains the queue every
+* <b>FlushInterval</b> milliseconds, or once <b>BatchSize</b> events
+* are queued, and passes all of them to the callback at once. Events
+* beyond <b>QueueLimit</b> are dropped and counted.</li>
+* <li>An event callback (setEventCallBack()), called by append() with a
+* span into the formatted buffer, so nothing is copied.</li>
+* <li>The callback of setCustomFunc(), shared by all CustomAppenders,
+* called with a C string.</li>
+* </ol>
+*
+* <h3>Properties</h3>
+* <dl>
+* <dt><tt>BatchSize</tt></dt>
+* <dd>Queued events that wake the drain thread early, 1024 by
+* default.</dd>
+* <dt><tt>FlushInterval</tt></dt>
+* <dd>Most milliseconds an event waits in the queue, 100 by default.</dd>
+* <dt><tt>QueueLimit</tt></dt>
+* <dd>Most events waiting for the batch callback, 100000 by default.</dd>
+* </dl>
+*/
+class LOG4CPLUS_EXPORT CustomAppender : public Appender, private Thread
 {
 public:
 	CustomAppender();
@@ -27,13 +83,88 @@ public:
 	virtual ~CustomAppender();
 
 	virtual void close();
+	virtual void flush();
+	virtual void setName(const std::string& name);
 
 	static void setCustomFunc(pCustomFuncCallBack pCustomFunc);	
 
+	/**
+	* Registers the event callback of the appenders named
+	* <code>appenderName</code>; NULL removes it.
+	*/
+	static void setEventCallBack(const std::string& appenderName, pCustomEventCallBack callBack, void* userData = NULL);
+
+	/**
+	* Registers the batch callback of the appenders named
+	* <code>appenderName</code>; NULL removes it, and events still queued
+	* go to the other callbacks.
+	*/
+	static void setBatchCallBack(const std::string& appenderName, pCustomBatchCallBack callBack, void* userData = NULL);
+
+	//! Number of events dropped because the queue was full.
+	AtomicInt64 getDroppedCount() const;
+
 protected:
 	virtual void append(const InternalLoggingEvent& loggingEvent);
 
 private:
+	struct QueuedEvent
+	{
+		int logLevel;
+		std::size_t loggerOffset;
+		std::size_t loggerLength;
+		std::size_t textOffset;
+		std::size_t length;
+	};
+
+	//! Queued events: their strings back to back, and where each one is.
+	//! The queue and the drain thread swap batches, keeping the capacity.
+	struct Batch
+	{
+		std::string data;
+		std::vector<QueuedEvent> events;
+
+		void swap(Batch& other)
+		{
+			data.swap(other.data);
+			events.swap(other.events);
+		}
+
+		void clear()
+		{
+			data.clear();
+			events.clear();
+		}
+	};
+
+	void init(const Properties& properties);
+	void updateCallBacks();
+	virtual void run();
+	void drainQueue();
+	void deliver(const Batch& batch);
+
+	unsigned int _batchSize;
+	unsigned long _flushMillis;
+	unsigned int _queueLimit;
+
+	// The registration for _name, read again when the registry changes.
+	AtomicInt _registryGeneration;
+	pCustomEventCallBack _eventCallBack;
+	void* _eventUserData;
+	bool _hasBatchCallBack;
+
+	Mutex _queueMutex;
+	Batch _queue;
+
+	// Held while a batch is taken from the queue and delivered, so the
+	// batches reach the callback one at a time and in order.
+	Mutex _drainMutex;
+	Batch _draining;
+	std::vector<CustomLogSpan> _spans;
+	ManualResetEvent _wakeup;
+	volatile AtomicInt _stopping;
+	mutable volatile AtomicInt64 _dropped;
+
 	CustomAppender(const CustomAppender&);
 
 	CustomAppender& operator=(const CustomAppender&);
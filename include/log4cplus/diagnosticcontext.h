@@ -0,0 +1,130 @@
+// Module:  Log4CPLUS
+// File:    diagnosticcontext.h
+
+#ifndef LOG4CPLUS_DIAGNOSTIC_CONTEXT_HEADER_
+#define LOG4CPLUS_DIAGNOSTIC_CONTEXT_HEADER_
+
+#include "log4cplus/platform.h"
+
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+/**
+* The mapped (MDC) and nested (NDC) diagnostic context of a thread, e.g.
+* the id of the request being served, shown by PatternLayout's
+* <code>%X{key}</code> and <code>%x</code>.
+*
+* Entries are kept in flat vectors whose slots are reused: a removed or
+* popped entry only lowers the count, so its strings keep their
+* capacity and pushing again in the request path does not allocate once
+* the slots are warm.
+*
+* The context of a thread lives in the thread's InternalLoggingEvent,
+* which layouts get by reference; a copy of the event, e.g. one queued
+* for a later thread, carries a snapshot of the context.
+*/
+class LOG4CPLUS_EXPORT DiagnosticContext
+{
+public:
+	DiagnosticContext();
+	DiagnosticContext(const DiagnosticContext& rhs);
+	DiagnosticContext& operator= (const DiagnosticContext& rhs);
+
+	void swap(DiagnosticContext& other);
+
+	// MDC
+
+	//! Sets <code>key</code> to <code>value</code>, replacing an earlier value.
+	void put(const std::string& key, const std::string& value);
+
+	//! Removes <code>key</code>; the other entries keep their order.
+	void remove(const std::string& key);
+
+	//! Returns the value of <code>key</code>, or NULL if it is not set.
+	const std::string* get(const std::string& key) const;
+
+	std::size_t getMappedCount() const { return _mappedCount; }
+	const std::string& getMappedKey(std::size_t index) const { return _mapped[index].key; }
+	const std::string& getMappedValue(std::size_t index) const { return _mapped[index].value; }
+
+	void clearMapped() { _mappedCount = 0; }
+
+	// NDC
+
+	void push(const std::string& message);
+
+	//! Removes the innermost message; does nothing when the stack is empty.
+	void pop();
+
+	std::size_t getDepth() const { return _depth; }
+
+	//! Returns the innermost message or an empty string.
+	const std::string& peek() const;
+
+	//! Appends the messages from the outermost on, separated by blanks.
+	void appendNested(std::string& result) const;
+
+	void clearNested() { _depth = 0; }
+
+private:
+	struct MappedEntry
+	{
+		std::string key;
+		std::string value;
+	};
+
+	void assign(const DiagnosticContext& rhs);
+
+	std::vector<MappedEntry> _mapped;
+	std::size_t _mappedCount;
+	std::vector<std::string> _nested;
+	std::size_t _depth;
+};
+
+
+//! Returns the diagnostic context of the calling thread.
+LOG4CPLUS_EXPORT DiagnosticContext& getDiagnosticContext();
+
+
+/**
+* Puts a key into the calling thread's MDC for the lifetime of the
+* object, e.g. for the duration of a request.
+*/
+class LOG4CPLUS_EXPORT MDCContextCreator
+{
+public:
+	MDCContextCreator(const std::string& key, const std::string& value);
+	~MDCContextCreator();
+
+private:
+	std::string _key;
+
+	MDCContextCreator(const MDCContextCreator&);
+	MDCContextCreator& operator= (const MDCContextCreator&);
+};
+
+
+/**
+* Pushes a message on the calling thread's NDC for the lifetime of the
+* object.
+*/
+class LOG4CPLUS_EXPORT NDCContextCreator
+{
+public:
+	explicit NDCContextCreator(const std::string& message);
+	~NDCContextCreator();
+
+private:
+	NDCContextCreator(const NDCContextCreator&);
+	NDCContextCreator& operator= (const NDCContextCreator&);
+};
+
+
+} // namespace log4cplus
+
+
+#endif // LOG4CPLUS_DIAGNOSTIC_CONTEXT_HEADER_
@@ -9,6 +9,10 @@
 
 #include "log4cplus/platform.h"
 
+#ifndef _MSC_VER
+#include <dirent.h>
+#endif
+
 //!Get environment variable value.
 bool getEnvString(std::string& envString, std::string const& name);
 
@@ -21,6 +25,50 @@ bool splitFilePath(std::vector<std::string>& components, std::size_t& special, s
 //!Makes directories leading to file.
 void make_dirs(std::string const& file_path);
 
+//!Splits a path into its directory ("." if it has none) and file name.
+void splitDirectory(std::string& directory, std::string& baseName, std::string const& path);
+
+//!Returns the id of the calling process, cached until refreshProcessId().
+int getProcessId();
+
+//!Reads the process id again, in the child after fork().
+void refreshProcessId();
+
+//!Returns the operating system id of the calling thread.
+unsigned long getThreadId();
+
+//!Returns the host name, or an empty string if it is not available.
+std::string getHostName();
+
+//!Returns the file name of the running executable, without directories.
+std::string getExecutableName();
+
+
+namespace log4cplus
+{
+	//!Reads the names in a directory one at a time; none if it cannot be opened.
+	class DirectoryScan
+	{
+	public:
+		explicit DirectoryScan(const std::string& directory);
+		~DirectoryScan();
+
+		bool next(std::string& name);
+
+	private:
+#ifdef _MSC_VER
+		HANDLE _find;
+		WIN32_FIND_DATAA _data;
+		bool _hasData;
+#else	//__linux__
+		DIR* _dir;
+#endif
+
+		DirectoryScan(const DirectoryScan&);
+		DirectoryScan& operator= (const DirectoryScan&);
+	};
+}
+
 
 
 #endif // LOG4CPLUS_INTERNAL_ENV_H
@@ -9,17 +9,52 @@
 #include "log4cplus/platform.h"
 #include "log4cplus/appender.h"
 #include "log4cplus/timeHelper.h"
+#include "log4cplus/atomic.h"
 
 #include <fstream>
 #include <memory>
+#include <vector>
 
 
 namespace log4cplus{
 
 
+struct ThreadBuffer;
+class ThreadBufferFlusher;
+class DurabilitySyncer;
+
+
+enum DurabilityPolicy { DURABILITY_NONE, DURABILITY_INTERVAL, DURABILITY_BYTES, DURABILITY_LEVEL };
+
+
 /**
 * Appends log events to a file. 
-* 
+*
+* With <b>WriteCombining</b> each logging thread formats its events
+* into a buffer of its own, with its own copy of the layout (see
+* Layout::clone()), and takes the appender lock only to write the whole
+* buffer to the file: once it holds <b>ThreadBufferSize</b> bytes, after
+* an ERROR or FATAL event, and every <b>ThreadFlushInterval</b>
+* milliseconds from a background thread. Events of one thread stay in
+* order; events of different threads are ordered per buffer rather than
+* per event. Layouts that cannot be cloned and filter chains other than
+* LogLevel filters keep the appender formatting under its lock.
+*
+* ImmediateFlush only hands the events to the operating system.
+* <b>Durability</b> also makes them durable with fdatasync()
+* (FlushFileBuffers() on Windows): <b>NONE</b> (default) never syncs,
+* <b>INTERVAL</b> syncs every <b>DurabilityInterval</b> milliseconds
+* (default 1000), <b>BYTES</b> once <b>DurabilityBytes</b> (default
+* 1048576) were written since the last request, and <b>LEVEL</b> makes
+* each event at or above <b>DurabilityLevel</b> (default ERROR) wait until
+* it is durable. A background thread does the syncing, so one fdatasync()
+* covers every event written before it started; BYTES and LEVEL also sync
+* every DurabilityInterval. The file is synced before it is closed or
+* rolled over.
+*
+* <b>MaxTotalSize</b> (with an optional KB, MB or GB suffix) and
+* <b>MaxAgeDays</b> hand the rolled files of the appender to the
+* RetentionManager, which deletes the oldest of them in the background.
 */
 class LOG4CPLUS_EXPORT FileAppender : public Appender 
 {
@@ -34,9 +69,49 @@ public:
 	virtual ~FileAppender();
 
 	virtual void close();
+	virtual void flush();
+
+	/**
+	* Switches to per-thread buffers, see WriteCombining. Call before the
+	* first event is appended.
+	*/
+	void setWriteCombining(std::size_t threadBufferSize, unsigned long flushMillis);
+
+	/**
+	* Sets the Durability policy, see above. Call before the first event
+	* is appended.
+	*/
+	void setDurability(DurabilityPolicy policy, unsigned long intervalMillis = 1000,
+		std::size_t bytes = 1048576, LogLevel level = ERROR_LOG_LEVEL);
+
+	/**
+	* Keeps the rolled files within <code>maxTotalSize</code> bytes and
+	* <code>maxAgeDays</code>, see RetentionManager; zero means no limit.
+	*/
+	void setRetention(long long maxTotalSize, unsigned int maxAgeDays);
 
 protected:
 	virtual void append(const InternalLoggingEvent& loggingEvent);
+	virtual void appendUnlocked(const InternalLoggingEvent& loggingEvent);
+
+	/**
+	* Writes formatted events to the file; <code>timestamp</code> is the
+	* time of the first of them. The rolling appenders roll the file over
+	* around it. Called with _mutex held.
+	*/
+	virtual void writeText(const char* data, std::size_t length, const TimeHelper& timestamp);
+
+	//! Writes the events of the thread buffers to the file.
+	void commitThreadBuffers();
+
+	/**
+	* Makes what was written durable if a Durability policy is set.
+	* Called with _mutex held before the file is closed or renamed.
+	*/
+	void syncFile();
+
+	//! Reports the paths a rollover renamed files to to the RetentionManager.
+	void notifyRolled(const std::vector<std::string>& paths);
 
 	void open(std::ios_base::openmode mode);
 
@@ -79,7 +154,35 @@ protected:
 	TimeHelper _reopen_time;
 
 private:
+	friend class ThreadBufferFlusher;
+	friend class DurabilitySyncer;
+
 	void init(const std::string& filename, std::ios_base::openmode mode);
+	ThreadBuffer* getThreadBuffer();
+	void commitThreadBuffer(ThreadBuffer& buffer);
+	void commitThreadBuffers(bool isReleasingIdle);
+	void closeThreadBuffers();
+
+	// WriteCombining; the list is guarded by _threadBuffersMutex.
+	std::size_t _threadBufferSize;
+	unsigned long _threadFlushMillis;
+	AtomicInt _threadBufferSerial;
+	Mutex _threadBuffersMutex;
+	std::vector<ThreadBuffer*> _threadBuffers;
+	bool _isThreadBuffersClosed;
+	ThreadBufferFlusher* _flusher;
+
+	// Durability; _writtenBytes counts the bytes written to all files
+	// of the appender and only changes with _mutex held.
+	DurabilityPolicy _durability;
+	unsigned long _durabilityMillis;
+	std::size_t _durabilityBytes;
+	LogLevel _durabilityLevel;
+	volatile AtomicInt64 _writtenBytes;
+	std::size_t _unrequestedBytes;
+	DurabilitySyncer* _syncer;
+
+	unsigned int _retentionId;
 
 	FileAppender(const FileAppender&);
 
@@ -94,6 +197,16 @@ typedef SharedPtr<FileAppender> SharedFileAppenderPtr;
 /**
 * RollingFileAppender extends FileAppender to backup the log
 * files when they reach a certain size.
+*
+* By default (<b>NamingScheme</b> INDEX) the backups are named
+* <code>app.log.1</code> (the newest) to
+* <code>app.log.</code><b>MaxBackupIndex</b>, so each rollover renames all
+* of them. With <b>NamingScheme</b> SEQUENCE the file is renamed once, to
+* the next sequence number (<code>app.log.000123</code>), and the backup
+* MaxBackupIndex numbers older is deleted: a rollover takes the same few
+* system calls whatever MaxBackupIndex. With <b>SequenceSymlink</b> the
+* events are written to the numbered file directly and the file name is a
+* symbolic link to it, replaced on each rollover (not on Windows).
 */
 class LOG4CPLUS_EXPORT RollingFileAppender : public FileAppender {
 public:
@@ -108,8 +221,15 @@ public:
 
 	virtual ~RollingFileAppender();
 
+	/**
+	* Switches to the SEQUENCE NamingScheme, with the file name as a
+	* symbolic link to the current file if <code>useSymlink</code> is set.
+	* Call before the first event is appended.
+	*/
+	void setSequenceNaming(bool useSymlink);
+
 protected:
-	virtual void append(const InternalLoggingEvent& loggingEvent);
+	virtual void writeText(const char* data, std::size_t length, const TimeHelper& timestamp);
 	void rollover();
 
 	long _maxFileSize;
@@ -117,6 +237,14 @@ protected:
 
 private:
 	void init(long maxFileSize, int maxBackupIndex);
+	void rolloverSequence();
+	std::string getSequenceFilename(long sequence) const;
+	void removeSequenceFile(long sequence);
+	void updateSymlink(const std::string& target);
+
+	bool _isSequenceNaming;
+	bool _isSymlinked;
+	long _sequence;		// of the newest backup, or of the current file if symlinked
 };
 
 
@@ -147,7 +275,7 @@ public:
 	virtual void close();
 
 protected:
-	virtual void append(const InternalLoggingEvent& loggingEvent);
+	virtual void writeText(const char* data, std::size_t length, const TimeHelper& timestamp);
 
 	void rollover();
 
@@ -166,6 +294,43 @@ private:
 };
 
 
+/**
+* SizeAndTimeRollingFileAppender rolls the file over at the end of each
+* period of its <b>Schedule</b>, like DailyRollingFileAppender, and
+* whenever it grows beyond <b>MaxFileSize</b>, like RollingFileAppender.
+* The file is renamed to the period and the next free index of the
+* period, e.g. <code>app.log.2009-11-07.3</code>; older files are never
+* renamed, so a rollover costs the same whatever the number of backups.
+* MaxBackupIndex does not apply; see MaxTotalSize and MaxAgeDays to
+* bound the rolled files.
+*/
+class LOG4CPLUS_EXPORT SizeAndTimeRollingFileAppender : public DailyRollingFileAppender {
+public:
+	SizeAndTimeRollingFileAppender(const std::string& filename,
+		DailyRollingFileSchedule schedule = DAILY,
+		long maxFileSize = 10*1024*1024, // 10 MB
+		bool immediateFlush = true,
+		bool createDirs = false);
+
+	SizeAndTimeRollingFileAppender(const Properties& properties);
+
+	virtual ~SizeAndTimeRollingFileAppender();
+
+	virtual void close();
+
+protected:
+	virtual void writeText(const char* data, std::size_t length, const TimeHelper& timestamp);
+
+	void rollover();
+
+	long _maxFileSize;
+	int _nextIndex;		// of the next file rolled over in the period
+
+private:
+	void init(long maxFileSize);
+};
+
+
 } // namespace log4cplus
 
 
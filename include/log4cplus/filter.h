@@ -10,6 +10,12 @@
 #include "log4cplus/platform.h"
 #include "log4cplus/sharedptr.h"
 #include "log4cplus/loglevel.h"
+#include "log4cplus/atomic.h"
+#include "log4cplus/tls.h"
+#include "log4cplus/mutex.h"
+#include "log4cplus/stringhelper.h"
+
+#include <vector>
 
 
 namespace log4cplus {
@@ -77,11 +83,37 @@ public:
 	*/
 	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const = 0;
 
+	/**
+	* Returns <code>true</code> when the filter has events of its own for
+	* the appender, see {@link #nextPendingEvent}.
+	*/
+	bool hasPendingEvents() const { return _pendingEvents != 0; }
+
+	/**
+	* Fills <code>loggingEvent</code> with the next event the filter wants
+	* appended (e.g. a repeat summary) and returns <code>true</code>, or
+	* returns <code>false</code> when there is none. Appender::doAppend()
+	* drains these after evaluating the chain, before the current event.
+	*/
+	virtual bool nextPendingEvent(InternalLoggingEvent& loggingEvent) const;
+
+	/**
+	* Filters whose decision depends on the LogLevel alone override this
+	* to store the decision for <code>ll</code> in <code>result</code> and
+	* return <code>true</code>. The default returns <code>false</code>.
+	* Appender::setFilter() uses it to precompute chains of such filters.
+	*/
+	virtual bool decideLevel(LogLevel ll, FilterResult& result) const;
+
 		
 	/**
 	* Points to the next filter in the filter chain.
 	*/
 	FilterPtr _nextFilter;
+
+protected:
+	/** Number of events waiting in {@link #nextPendingEvent}. */
+	mutable volatile AtomicInt _pendingEvents;
 };
 
 
@@ -104,6 +136,8 @@ public:
 	* Always returns the {@link #DENY} regardless of the {@link InternalLoggingEvent} parameter.
 	*/
 	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+	virtual bool decideLevel(LogLevel ll, FilterResult& result) const;
 };
 
 
@@ -136,6 +170,8 @@ public:
 	*/
 	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
 
+	virtual bool decideLevel(LogLevel ll, FilterResult& result) const;
+
 private:
 		
 	void init();
@@ -161,6 +197,8 @@ public:
 	*/
 	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
 
+	virtual bool decideLevel(LogLevel ll, FilterResult& result) const;
+
 private:
 		
 	void init();
@@ -170,6 +208,194 @@ private:
 };
 
 
+/**
+* Rate limits events with a token bucket: on average <b>Rate</b> events
+* per second pass, with bursts of up to <b>Burst</b> events (defaults to
+* <b>Rate</b>). Events over the limit are denied, others are passed on
+* as {@link #NEUTRAL}.
+*
+* With <b>Key</b> set to <code>logger</code> or <code>message</code>
+* each logger name or message text is limited separately, using a fixed
+* table of <b>Buckets</b> buckets (64 by default) indexed by hash;
+* colliding keys share a bucket. Otherwise one bucket limits everything.
+*
+* The bucket state is a single 64-bit "theoretical arrival time" updated
+* by compare-and-swap (GCRA), so the decision takes no lock.
+*/
+class LOG4CPLUS_EXPORT TokenBucketFilter : public Filter
+{
+public:
+	enum KeyType { GLOBAL_KEY, LOGGER_KEY, MESSAGE_KEY };
+
+	TokenBucketFilter(unsigned int rate, unsigned int burst, KeyType key = GLOBAL_KEY, unsigned int buckets = 64);
+	TokenBucketFilter(const Properties& p);
+	virtual ~TokenBucketFilter();
+
+	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+	//! Number of events denied so far.
+	AtomicInt64 getSuppressedCount() const;
+
+private:
+	void init(unsigned int rate, unsigned int burst, KeyType key, unsigned int buckets);
+
+	AtomicInt64 _intervalNanos;
+	AtomicInt64 _toleranceNanos;
+	KeyType _key;
+	unsigned int _bucketMask;
+	volatile AtomicInt64* _buckets;
+	mutable volatile AtomicInt64 _suppressed;
+
+	TokenBucketFilter(const TokenBucketFilter&);
+	TokenBucketFilter& operator= (const TokenBucketFilter&);
+};
+
+
+/**
+* Passes on a sample of the events and denies the rest. With
+* <b>SampleEvery</b>=N the first of every N events logged by each thread
+* is kept; with <b>Probability</b>=p (0..1) each event is kept with
+* probability p, drawn from a per-thread pseudo random sequence started
+* from <b>Seed</b>, so a given thread always makes the same decisions.
+*
+* The per-thread state lives directly in a thread local slot, so the
+* decision needs neither a lock nor an atomic operation.
+*/
+class LOG4CPLUS_EXPORT SamplingFilter : public Filter
+{
+public:
+	SamplingFilter(unsigned int sampleEvery);
+	SamplingFilter(const Properties& p);
+	virtual ~SamplingFilter();
+
+	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+	//! Number of events denied so far.
+	AtomicInt64 getSuppressedCount() const;
+
+private:
+	void init();
+
+	unsigned int _sampleEvery;
+	bool _isProbabilistic;
+	unsigned long long _threshold;	// keep when random < threshold, out of 2^32
+	unsigned int _seed;
+	TLSKeyType _stateKey;
+	mutable volatile AtomicInt64 _suppressed;
+
+	SamplingFilter(const SamplingFilter&);
+	SamplingFilter& operator= (const SamplingFilter&);
+};
+
+
+/**
+* Collapses repeated identical events. The first occurrence of a
+* (logger, LogLevel, message) triple opens a window of <b>Window</b>
+* seconds (10 by default) during which repeats are denied. Once the
+* window has passed, a "last message repeated N times" event is handed
+* to the appender, using the logger and LogLevel of the repeated event.
+*
+* Triples are tracked by hash in a fixed table of <b>TableSize</b> slots
+* (64 by default). The common paths, a repeat inside its window or a new
+* message, are decided with atomic operations only; a slot taken over by
+* a different message reports the repeats of its previous owner. Counts
+* are approximate when threads race on the same slot.
+*/
+class LOG4CPLUS_EXPORT DuplicateSuppressionFilter : public Filter
+{
+public:
+	DuplicateSuppressionFilter(int windowSeconds = 10, unsigned int tableSize = 64);
+	DuplicateSuppressionFilter(const Properties& p);
+	virtual ~DuplicateSuppressionFilter();
+
+	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+	virtual bool nextPendingEvent(InternalLoggingEvent& loggingEvent) const;
+
+	//! Number of events denied so far.
+	AtomicInt64 getSuppressedCount() const;
+
+private:
+	struct Slot;
+	struct Summary
+	{
+		std::string loggerName;
+		LogLevel ll;
+		AtomicInt repeats;
+	};
+
+	void init(int windowSeconds, unsigned int tableSize);
+	void reportRepeats(Slot& slot) const;
+	void sweep(AtomicInt64 now) const;
+
+	AtomicInt64 _windowMicros;
+	unsigned int _slotMask;
+	Slot* _slots;
+	mutable volatile AtomicInt64 _nextSweep;
+	mutable volatile AtomicInt64 _suppressed;
+
+	// Summaries are rare, a lock is fine here.
+	mutable Mutex _summaryMutex;
+	mutable std::vector<Summary> _summaries;
+
+	DuplicateSuppressionFilter(const DuplicateSuppressionFilter&);
+	DuplicateSuppressionFilter& operator= (const DuplicateSuppressionFilter&);
+};
+
+
+/**
+* This is a very simple filter based on string matching.
+*
+* The filter admits two options <b>StringToMatch</b> and
+* <b>AcceptOnMatch</b>. If the message of the {@link InternalLoggingEvent}
+* contains <b>StringToMatch</b>, {@link #ACCEPT} is returned when
+* <b>AcceptOnMatch</b> is <code>true</code> (the default) and {@link #DENY}
+* otherwise. If there is no match, {@link #NEUTRAL} is returned.
+*
+* The search is prepared once at construction, see StringSearcher.
+*/
+class LOG4CPLUS_EXPORT StringMatchFilter : public Filter
+{
+public:
+	StringMatchFilter(const std::string& stringToMatch, bool acceptOnMatch = true);
+	StringMatchFilter(const Properties& p);
+
+	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+private:
+	StringSearcher _searcher;
+	bool _acceptOnMatch;
+};
+
+
+/**
+* Like StringMatchFilter, but matches the message against the extended
+* regular expression given in <b>Pattern</b>. The expression is compiled
+* once at construction; an invalid one is reported through LogLog and
+* makes the filter always return {@link #NEUTRAL}.
+*/
+class LOG4CPLUS_EXPORT RegexFilter : public Filter
+{
+public:
+	RegexFilter(const std::string& pattern, bool acceptOnMatch = true);
+	RegexFilter(const Properties& p);
+	virtual ~RegexFilter();
+
+	virtual FilterResult decide(const InternalLoggingEvent& loggingEvent) const;
+
+private:
+	struct CompiledRegex;
+
+	void init(const std::string& pattern);
+
+	CompiledRegex* _regex;
+	bool _acceptOnMatch;
+
+	RegexFilter(const RegexFilter&);
+	RegexFilter& operator= (const RegexFilter&);
+};
+
+
 } // namespace log4cplus
 
 
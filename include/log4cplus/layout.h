@@ -9,7 +9,10 @@
 #include "log4cplus/platform.h"
 #include "log4cplus/loglevel.h"
 #include "log4cplus/property.h"
+#include "log4cplus/bytesink.h"
 
+#include <ctime>
+#include <memory>
 #include <vector>
 
 
@@ -19,6 +22,7 @@ namespace log4cplus {
 class PatternConverter;
 class TimeHelper;
 class InternalLoggingEvent;
+class LogField;
 
 /**
 * This class is used to layout std::strings sent to an {@link Appender}.
@@ -32,10 +36,38 @@ public:
 
 	virtual void formatAndAppend(std::ostream& output, const InternalLoggingEvent& loggingEvent) = 0;
 
+	/**
+	* Writes the event to <code>sink</code>, which is how the appenders
+	* format it. The built-in layouts write to the sink directly and
+	* implement formatAndAppend() on top of this; the default
+	* implementation runs formatAndAppend() on a stream writing to the
+	* sink, for layouts implementing that only. A class derived from a
+	* built-in layout that changes what it writes overrides both.
+	*/
+	virtual void format(ByteSink& sink, const InternalLoggingEvent& loggingEvent);
+
+	/**
+	* Describes what the layout writes: two layouts returning the same
+	* non-empty key format any event to the same text, so appenders using
+	* them can share one formatting of each event (see getLayoutShareId()).
+	* The default, an empty key, shares with no other layout; the built-in
+	* layouts start theirs with the name of their dynamic type.
+	*/
+	virtual std::string getFormatKey() const;
+
+	/**
+	* Returns a new layout formatting like this one, e.g. for a thread
+	* formatting on its own, or an empty pointer if the layout cannot be
+	* copied, which the default implementation returns.
+	*/
+	virtual std::auto_ptr<Layout> clone() const;
+
 protected:
 	LogLevelManager& _llmCache;
 
 private:
+	std::auto_ptr<ByteSinkStream> _sinkStream;
+
 	// Disable copy
 	Layout(const Layout&);
 	Layout& operator= (Layout const&);
@@ -54,6 +86,9 @@ public:
 	virtual ~SimpleLayout();
 
 	virtual void formatAndAppend(std::ostream& output, const InternalLoggingEvent& loggingEvent);
+	virtual void format(ByteSink& sink, const InternalLoggingEvent& loggingEvent);
+	virtual std::string getFormatKey() const;
+	virtual std::auto_ptr<Layout> clone() const;
 
 private: 
 	// Disallow copying of instances of this class
@@ -65,8 +100,20 @@ private:
 LOG4CPLUS_EXPORT TimeHelper const& getLayoutTimeBase();
 
 
+//! Returns the id of a Layout::getFormatKey() value: the same non-zero
+//! id for equal keys, 0 for an empty key.
+LOG4CPLUS_EXPORT unsigned int getLayoutShareId(const std::string& formatKey);
+
+
 /**
 * A flexible layout configurable with pattern std::string.
+*
+* <code>%E{VAR}</code> shows the value environment variable
+* <code>VAR</code> had when the layout was created. It is read again
+* every <b>EnvRefreshInterval</b> seconds when that property is set, or
+* after refreshEnvironment(). The host name (<code>%h</code>) and the
+* executable name (<code>%e</code>) are formatted once, when the pattern
+* is parsed, and kept as literal text.
 */
 class LOG4CPLUS_EXPORT PatternLayout : public Layout
 {
@@ -77,11 +124,18 @@ public:
 	virtual ~PatternLayout();
 
 	virtual void formatAndAppend(std::ostream& output, const InternalLoggingEvent& loggingEvent);
+	virtual void format(ByteSink& sink, const InternalLoggingEvent& loggingEvent);
+	virtual std::string getFormatKey() const;
+	virtual std::auto_ptr<Layout> clone() const;
+
+	//! Makes every PatternLayout read its %E variables again.
+	static void refreshEnvironment();
 
 protected:
-	void init(const std::string& pattern);
+	void init(const std::string& pattern, int envRefreshInterval = 0);
 	
 	std::string _pattern;
+	int _envRefreshInterval;
 	std::vector<PatternConverter*> _parsedPattern;
 
 private: 
@@ -91,6 +145,67 @@ private:
 };
 
 
+/**
+* Formats every event as one JSON object per line, e.g.
+*
+* <code>{"timestamp":"2024-05-01T12:00:00.000123Z","level":"INFO",
+* "logger":"app.db","pid":4242,"thread":4243,"message":"connected"}</code>
+*
+* <h3>Properties</h3>
+* <dl>
+* <dt><tt>TimestampField</tt>, <tt>LevelField</tt>, <tt>LoggerField</tt>,
+* <tt>PidField</tt>, <tt>ThreadField</tt>, <tt>MessageField</tt></dt>
+* <dd>Name of the member for each field, defaulting to the names above.
+* A field set to an empty name is left out.</dd>
+* <dt><tt>TimestampFormat</tt></dt>
+* <dd><code>ISO8601</code> (default, UTC) or <code>EpochMicros</code>
+* for a number of microseconds since the epoch.</dd>
+* </dl>
+*
+* Key/value fields of the event follow as members of their own, keeping
+* numbers and booleans unquoted.
+*
+* The line is built in a buffer kept by the layout, escaping the message
+* with appendJsonEscaped(), and appended to the sink at once.
+*/
+class LOG4CPLUS_EXPORT JsonLayout : public Layout
+{
+public:
+	enum TimestampFormat { ISO8601_TIMESTAMP, EPOCH_MICROS_TIMESTAMP };
+
+	JsonLayout();
+	JsonLayout(const Properties& properties);
+	virtual ~JsonLayout();
+
+	virtual void formatAndAppend(std::ostream& output, const InternalLoggingEvent& loggingEvent);
+	virtual void format(ByteSink& sink, const InternalLoggingEvent& loggingEvent);
+	virtual std::string getFormatKey() const;
+	virtual std::auto_ptr<Layout> clone() const;
+
+private:
+	void init(const Properties& properties);
+	void appendTimestamp(const TimeHelper& timestamp);
+	void appendField(const LogField& field);
+
+	// Member names as "name": with their leading comma, if any.
+	std::string _timestampKey;
+	std::string _levelKey;
+	std::string _loggerKey;
+	std::string _pidKey;
+	std::string _threadKey;
+	std::string _messageKey;
+	TimestampFormat _timestampFormat;
+
+	std::string _buffer;
+	time_t _cachedSecond;
+	std::string _cachedDateTime;	// "YYYY-MM-DDTHH:MM:SS" of _cachedSecond
+
+	// Disallow copying of instances of this class
+	JsonLayout(const JsonLayout&);
+	JsonLayout& operator= (const JsonLayout&);
+};
+
+
 } // namespace log4cplus
 
 #endif // LOG4CPLUS_LAYOUT_HEADER_
@@ -162,6 +162,14 @@ public:
 	*/
 	void setLogLevel(LogLevel ll);
 
+	/**
+	* Whether events logged here also go to the appenders of the
+	* ancestors, <code>true</code> by default.
+	*/
+	bool getAdditivity() const;
+
+	void setAdditivity(bool additivity);
+
 	/**
 	* Return the the {@link Hierarchy} where this <code>Logger</code> instance is
 	* attached.
@@ -186,6 +194,12 @@ public:
 
 	virtual void removeAppender(const std::string& name);
 
+	/**
+	* Replaces all appenders of this Logger at once, see
+	* AppenderAttachableImpl::setAppenders().
+	*/
+	void setAppenders(const SharedAppenderPtrList& appenders);
+
 	Logger ();
 	Logger(const Logger& rhs);
 	Logger& operator= (const Logger& rhs);
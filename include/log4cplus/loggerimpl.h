@@ -20,6 +20,7 @@ namespace log4cplus {
 
 
 	class DefaultLoggerFactory;
+	struct FlattenedAppenders;
 
 
 /**
@@ -38,6 +39,11 @@ public:
 	* Call the appenders in the hierrachy starting at
 	* <code>this</code>.  If no appenders could be found, emit a
 	* warning.
+	*
+	* The appenders of this logger and its ancestors, up to the first
+	* one that is not additive, are collected once into a flattened
+	* list without duplicates. It is built again after any appender
+	* list, parent or additivity changed.
 	* 
 	* This method calls all the appenders inherited from the
 	* hierarchy circumventing any evaluation of whether to log or not
@@ -90,6 +96,14 @@ public:
 	*/
 	void setLogLevel(LogLevel _ll) { this->_ll = _ll; }
 
+	/**
+	* Whether events are also passed to the appenders of the ancestors,
+	* <code>true</code> by default.
+	*/
+	bool getAdditivity() const { return _additivity; }
+
+	void setAdditivity(bool additivity);
+
 	/**
 	* Return the the {@link Hierarchy} where this <code>Logger</code>
 	* instance is attached.
@@ -143,11 +157,22 @@ protected:
 	*/
 	SharedLoggerImplPtr _parent;
 
+	bool _additivity;
+
 private:
+	FlattenedAppenders* getFlattenedAppenders(AtomicInt changeCount);
 	
 	/** Loggers need to know what Hierarchy they are in. */
 	Hierarchy& _hierarchy;
 
+	// The current flattened list is read without a lock while
+	// _dispatching counts the callAppenders() calls in progress. Replaced
+	// lists are kept in _retiredAppenders until none can be using them.
+	FlattenedAppenders* volatile _flattenedAppenders;
+	std::vector<FlattenedAppenders*> _retiredAppenders;
+	volatile AtomicInt _dispatching;
+	Mutex _flattenMutex;
+
 	// Disallow copying of instances of this class
 	LoggerImpl(const LoggerImpl&);
 	LoggerImpl& operator= (const LoggerImpl&);
@@ -9,8 +9,11 @@
 #include "log4cplus/loglevel.h"
 #include "log4cplus/timehelper.h"
 #include "log4cplus/tls.h"
+#include "log4cplus/diagnosticcontext.h"
 
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace log4cplus { 
 
@@ -18,6 +21,68 @@ namespace log4cplus {
 class TimeHelper;
 
 
+/**
+* Where a log statement is. The logging macros define one per call site
+* as a static object pointing at the compiler's strings for
+* <code>__FILE__</code> and <code>__FUNCTION__</code>, so events only
+* carry a pointer to it.
+*/
+struct LOG4CPLUS_EXPORT LogLocation
+{
+	const char* file;
+	int line;
+	const char* function;
+
+	//! Set by getBasename() the first time it is called.
+	mutable const char* basename;
+
+	//! The part of <code>file</code> after its last path separator.
+	const char* getBasename() const;
+};
+
+
+/**
+* A typed key/value pair attached to a logging event, e.g. by
+* LOG4CPLUS_INFO_KV. The value keeps its type until a layout renders it.
+*/
+class LOG4CPLUS_EXPORT LogField
+{
+public:
+	enum Type { INTEGER_FIELD, UNSIGNED_FIELD, DOUBLE_FIELD, BOOL_FIELD, STRING_FIELD };
+
+	LogField() : _type(INTEGER_FIELD) { _value.i = 0; }
+
+	const std::string& getKey() const { return _key; }
+	Type getType() const { return _type; }
+
+	long long getInteger() const { return _value.i; }
+	unsigned long long getUnsigned() const { return _value.u; }
+	double getDouble() const { return _value.d; }
+	bool getBool() const { return _value.b; }
+	const std::string& getString() const { return _text; }
+
+	/**
+	* Appends the value as text: numbers in decimal, booleans as
+	* <code>true</code> or <code>false</code>, strings unchanged.
+	*/
+	void appendValue(std::string& result) const;
+
+private:
+	friend class InternalLoggingEvent;
+
+	std::string _key;
+	Type _type;
+	union
+	{
+		long long i;
+		unsigned long long u;
+		double d;
+		bool b;
+	} _value;
+	std::string _text;
+};
+
+
 /**
 * The internal representation of logging events. When an affirmative
 * decision is made to log then a <code>InternalLoggingEvent</code>
@@ -48,7 +113,57 @@ public:
 
 	virtual ~InternalLoggingEvent();
 
-	void setLoggingEvent(const std::string& logger, LogLevel ll, const std::string& message);
+	void setLoggingEvent(const std::string& logger, LogLevel ll, const std::string& message,
+		const LogLocation* location = NULL);
+
+	enum { MAX_FIELDS = 8 };
+
+	/**
+	* Attach a key/value field. The slots are part of the event and their
+	* strings keep their capacity, so reusing the thread's event does not
+	* allocate once warmed up. Fields beyond MAX_FIELDS are ignored.
+	* setLoggingEvent() removes all fields.
+	*/
+	void addField(const char* key, int value) { addField(key, static_cast<long long>(value)); }
+	void addField(const char* key, long value) { addField(key, static_cast<long long>(value)); }
+	void addField(const char* key, long long value);
+	void addField(const char* key, unsigned int value) { addField(key, static_cast<unsigned long long>(value)); }
+	void addField(const char* key, unsigned long value) { addField(key, static_cast<unsigned long long>(value)); }
+	void addField(const char* key, unsigned long long value);
+	void addField(const char* key, double value);
+	void addField(const char* key, bool value);
+	void addField(const char* key, const char* value);
+	void addField(const char* key, const std::string& value);
+
+	void clearFields()
+	{
+		_fieldCount = 0;
+	}
+
+	unsigned int getFieldCount() const
+	{
+		return _fieldCount;
+	}
+
+	const LogField& getField(unsigned int index) const
+	{
+		return _fields[index];
+	}
+
+	/**
+	* The MDC and NDC. For the event of a thread, the one the logging
+	* macros fill, this is the thread's own context; copies of an event
+	* get a snapshot of it.
+	*/
+	const DiagnosticContext& getDiagnosticContext() const
+	{
+		return _context;
+	}
+
+	DiagnosticContext& getDiagnosticContext()
+	{
+		return _context;
+	}
 
 	// public virtual methods
 	/** The application supplied message of logging loggingEvent. */
@@ -89,6 +204,53 @@ public:
 		return _timestamp;
 	}
 
+	/** Source location of the log statement, or NULL if unknown. */
+	const LogLocation* getLocation() const
+	{
+		return _location;
+	}
+
+	/** Operating system id of the thread that created the logging
+	*  loggingEvent, in decimal. It is rendered once per thread, when the
+	*  thread's event is created. */
+	const std::string& getThread() const
+	{
+		return _thread;
+	}
+
+	/** Name given to that thread with setThreadName(), or its id. */
+	const std::string& getThreadName() const
+	{
+		return _threadName.empty() ? _thread : _threadName;
+	}
+
+	void setThreadName(const std::string& name)
+	{
+		_threadName = name;
+	}
+
+	/** Takes the id of the calling thread, e.g. in the child process
+	*  after fork(). */
+	void refreshThread();
+
+	/**
+	* Starts or ends a dispatch of this event in which appenders with
+	* layouts of the same share id format it once, see
+	* Appender::formatEvent(). Texts of an earlier dispatch are dropped.
+	*/
+	void setFormatSharing(bool enable) const
+	{
+		_isSharingFormats = enable;
+		_sharedFormatCount = 0;
+	}
+
+	/**
+	* Returns the text shared by the layouts of <code>shareId</code> in
+	* the current dispatch, or NULL outside one. <code>isNew</code> is set
+	* if the text is still to be formatted.
+	*/
+	std::string* getSharedFormat(unsigned int shareId, bool& isNew) const;
+
 	void swap(InternalLoggingEvent &);
 
 	// public operators
@@ -98,11 +260,30 @@ public:
 	static unsigned int getDefaultType();
 
 protected:
+	LogField* nextField(const char* key, LogField::Type type);
 	
 	std::string _message;
 	std::string _loggerName;
 	LogLevel _ll;
 	TimeHelper _timestamp;
+	const LogLocation* _location;
+	std::string _thread;
+	std::string _threadName;
+	LogField _fields[MAX_FIELDS];
+	unsigned int _fieldCount;
+	DiagnosticContext _context;
+
+private:
+	struct SharedFormat
+	{
+		unsigned int shareId;
+		std::string text;
+	};
+
+	// Not copied with the event; the slots keep their capacity.
+	mutable std::vector<SharedFormat> _sharedFormats;
+	mutable std::size_t _sharedFormatCount;
+	mutable bool _isSharingFormats;
 };
 
 
@@ -134,6 +315,10 @@ inline InternalLoggingEvent* getInternalLoggingEvent(bool alloc = true)
 }
 
 
+//! Names the calling thread, as shown by PatternLayout's %T.
+LOG4CPLUS_EXPORT void setThreadName(const std::string& name);
+
+
 } // namespace log4cplus
 
 #endif // LOG4CPLUS_SPI_INTERNAL_LOGGING_EVENT_HEADER_
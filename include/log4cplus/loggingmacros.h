@@ -7,6 +7,7 @@
 
 #include "log4cplus/platform.h"
 #include "log4cplus/logger.h"
+#include "log4cplus/loggingevent.h"
 
 #include <sstream>
 #include <utility>
@@ -69,18 +70,91 @@ inline Logger macros_getLogger(char const* logger)
 }
 
 
-LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const&);
+LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const&,
+	LogLocation const* location = NULL);
+
+
+//! Fills the thread's event for the LOG4CPLUS_*_KV macros.
+LOG4CPLUS_EXPORT InternalLoggingEvent& macro_prepareEvent(Logger const&, LogLevel, std::string const&,
+	LogLocation const* location);
+
+
+template<class V1>
+void macro_forcedLogKV(Logger const& logger, LogLevel logLevel, LogLocation const* location, std::string const& msg,
+	char const* k1, V1 const& v1)
+{
+	InternalLoggingEvent& loggingEvent = macro_prepareEvent(logger, logLevel, msg, location);
+	loggingEvent.addField(k1, v1);
+	logger.forcedLog(loggingEvent);
+}
+
+
+template<class V1, class V2>
+void macro_forcedLogKV(Logger const& logger, LogLevel logLevel, LogLocation const* location, std::string const& msg,
+	char const* k1, V1 const& v1, char const* k2, V2 const& v2)
+{
+	InternalLoggingEvent& loggingEvent = macro_prepareEvent(logger, logLevel, msg, location);
+	loggingEvent.addField(k1, v1);
+	loggingEvent.addField(k2, v2);
+	logger.forcedLog(loggingEvent);
+}
+
+
+template<class V1, class V2, class V3>
+void macro_forcedLogKV(Logger const& logger, LogLevel logLevel, LogLocation const* location, std::string const& msg,
+	char const* k1, V1 const& v1, char const* k2, V2 const& v2, char const* k3, V3 const& v3)
+{
+	InternalLoggingEvent& loggingEvent = macro_prepareEvent(logger, logLevel, msg, location);
+	loggingEvent.addField(k1, v1);
+	loggingEvent.addField(k2, v2);
+	loggingEvent.addField(k3, v3);
+	logger.forcedLog(loggingEvent);
+}
+
+
+template<class V1, class V2, class V3, class V4>
+void macro_forcedLogKV(Logger const& logger, LogLevel logLevel, LogLocation const* location, std::string const& msg,
+	char const* k1, V1 const& v1, char const* k2, V2 const& v2, char const* k3, V3 const& v3,
+	char const* k4, V4 const& v4)
+{
+	InternalLoggingEvent& loggingEvent = macro_prepareEvent(logger, logLevel, msg, location);
+	loggingEvent.addField(k1, v1);
+	loggingEvent.addField(k2, v2);
+	loggingEvent.addField(k3, v3);
+	loggingEvent.addField(k4, v4);
+	logger.forcedLog(loggingEvent);
+}
 
 
 } // namespace log4cplus
 
 
+//! Defines the static LogLocation of a log statement; it is constant
+//! initialized, so it costs nothing at run time.
+#define LOG4CPLUS_DEFINE_LOCATION(name)                                 \
+    static LogLocation name = { __FILE__, __LINE__, __FUNCTION__, NULL }
+
+
 #define LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, logLevel)            \
     LOG4CPLUS_SUPPRESS_DOWHILE_WARNING()                                \
     do {                                                                \
         Logger const& constLogger = macros_getLogger(logger);			\
         if(constLogger.isEnabledFor(logLevel)) {						\
-            macro_forcedLog(constLogger, logLevel, logEvent);			\
+            LOG4CPLUS_DEFINE_LOCATION(location);						\
+            macro_forcedLog(constLogger, logLevel, logEvent, &location);	\
+        }                                                               \
+    } while(0)                                                          \
+    LOG4CPLUS_RESTORE_DOWHILE_WARNING()
+
+
+// The fields are only evaluated and stored when the level is enabled.
+#define LOG4CPLUS_MACRO_KV_BODY(logger, logLevel, ...)                  \
+    LOG4CPLUS_SUPPRESS_DOWHILE_WARNING()                                \
+    do {                                                                \
+        Logger const& constLogger = macros_getLogger(logger);			\
+        if(constLogger.isEnabledFor(logLevel)) {						\
+            LOG4CPLUS_DEFINE_LOCATION(location);						\
+            macro_forcedLogKV(constLogger, logLevel, &location, __VA_ARGS__);	\
         }                                                               \
     } while(0)                                                          \
     LOG4CPLUS_RESTORE_DOWHILE_WARNING()
@@ -90,13 +164,22 @@ LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const
  * @def LOG4CPLUS_DEBUG(logger, logEvent)  This macro is used to log a
  * DEBUG_LOG_LEVEL message to <code>logger</code>.
  * <code>logEvent</code> will be streamed into an <code>ostream</code>.
+ *
+ * The <code>_KV</code> variants of the macros take the message followed
+ * by up to four key/value pairs, e.g.
+ * <code>LOG4CPLUS_INFO_KV(logger, "done", "user", id, "latency_us", t)</code>.
+ * The values are attached to the event as typed fields and only
+ * formatted by layouts using them (%K or JsonLayout).
  */
 #if !defined(LOG4CPLUS_DISABLE_DEBUG)
 #define LOG4CPLUS_DEBUG(logger, logEvent)                               \
     LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, DEBUG_LOG_LEVEL)
+#define LOG4CPLUS_DEBUG_KV(logger, ...)                                \
+    LOG4CPLUS_MACRO_KV_BODY(logger, DEBUG_LOG_LEVEL, __VA_ARGS__)
 
 #else
 #define LOG4CPLUS_DEBUG(logger, logEvent) LOG4CPLUS_DOWHILE_NOTHING()
+#define LOG4CPLUS_DEBUG_KV(logger, ...) LOG4CPLUS_DOWHILE_NOTHING()
 
 #endif
 
@@ -108,9 +191,12 @@ LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const
 #if !defined(LOG4CPLUS_DISABLE_INFO)
 #define LOG4CPLUS_INFO(logger, logEvent)                                \
     LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, INFO_LOG_LEVEL)
+#define LOG4CPLUS_INFO_KV(logger, ...)                                \
+    LOG4CPLUS_MACRO_KV_BODY(logger, INFO_LOG_LEVEL, __VA_ARGS__)
 
 #else
 #define LOG4CPLUS_INFO(logger, logEvent) LOG4CPLUS_DOWHILE_NOTHING()
+#define LOG4CPLUS_INFO_KV(logger, ...) LOG4CPLUS_DOWHILE_NOTHING()
 
 #endif
 
@@ -123,11 +209,14 @@ LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const
 #if !defined(LOG4CPLUS_DISABLE_ERROR)
 #define LOG4CPLUS_ERROR(logger, logEvent)                               \
     LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, ERROR_LOG_LEVEL)
+#define LOG4CPLUS_ERROR_KV(logger, ...)                                \
+    LOG4CPLUS_MACRO_KV_BODY(logger, ERROR_LOG_LEVEL, __VA_ARGS__)
 #define LOG4CPLUS_ERROR_STR(logger, logEvent)                           \
     LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, ERROR_LOG_LEVEL)
 
 #else
 #define LOG4CPLUS_ERROR(logger, logEvent) LOG4CPLUS_DOWHILE_NOTHING()
+#define LOG4CPLUS_ERROR_KV(logger, ...) LOG4CPLUS_DOWHILE_NOTHING()
 #define LOG4CPLUS_ERROR_STR(logger, logEvent) LOG4CPLUS_DOWHILE_NOTHING()
 
 #endif
@@ -140,9 +229,12 @@ LOG4CPLUS_EXPORT void macro_forcedLog(Logger const&, LogLevel, std::string const
 #if !defined(LOG4CPLUS_DISABLE_FATAL)
 #define LOG4CPLUS_FATAL(logger, logEvent)                               \
     LOG4CPLUS_MACRO_STR_BODY(logger, logEvent, FATAL_LOG_LEVEL)
+#define LOG4CPLUS_FATAL_KV(logger, ...)                                \
+    LOG4CPLUS_MACRO_KV_BODY(logger, FATAL_LOG_LEVEL, __VA_ARGS__)
 
 #else
 #define LOG4CPLUS_FATAL(logger, logEvent) LOG4CPLUS_DOWHILE_NOTHING()
+#define LOG4CPLUS_FATAL_KV(logger, ...) LOG4CPLUS_DOWHILE_NOTHING()
 #endif
 
 
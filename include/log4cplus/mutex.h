@@ -3,8 +3,10 @@
 #define LOG4CPLUS_MUTEX_H_
 
 #include "log4cplus/platform.h"
+#include "log4cplus/atomic.h"
 
 #include <cassert>
+#include <iosfwd>
 
 namespace log4cplus
 {
@@ -17,17 +19,49 @@ namespace log4cplus
 #endif
 
 
+/**
+* Lock statistics shared by all mutexes constructed with the same name.
+* Only collected when the library is built with LOG4CPLUS_MUTEX_STATS.
+*/
+struct MutexStats
+{
+	const char* name;
+	volatile AtomicInt64 acquisitions;
+	volatile AtomicInt64 contentions;	// acquisitions where trylock failed
+	volatile AtomicInt64 waitMicros;	// time spent blocked by contentions
+	MutexStats* next;
+};
+
+
 class Mutex 
 {
 public:
-	Mutex();
+	/**
+	* <code>name</code> must be a string literal (or otherwise outlive
+	* the process). It is used to aggregate lock statistics when
+	* LOG4CPLUS_MUTEX_STATS is defined and ignored otherwise.
+	*/
+	explicit Mutex(const char* name = 0);
 	~Mutex();
 
 	void Lock();    
 	void Unlock(); 
 
+	/**
+	* Writes acquisitions, contended acquisitions and cumulative wait
+	* time of every named mutex to <code>os</code>. Without
+	* LOG4CPLUS_MUTEX_STATS only a notice is written.
+	*/
+	static void dumpStats(std::ostream& os);
+
+	//! Zeroes all counters reported by dumpStats().
+	static void resetStats();
+
 private:
 	MutexType _mutex;
+	// Present in both builds so that the layout of every class embedding
+	// a Mutex does not depend on LOG4CPLUS_MUTEX_STATS.
+	MutexStats* _stats;
 
 	Mutex(Mutex* /*ignored*/) {}
 	Mutex(const Mutex&);
@@ -88,6 +88,9 @@ public:
 	bool getULong(unsigned long& val, std::string const& key) const;
 	bool getBool(bool& val, std::string const& key) const;
 
+	bool operator== (const Properties& rhs) const { return _stringMap == rhs._stringMap; }
+	bool operator!= (const Properties& rhs) const { return _stringMap != rhs._stringMap; }
+
 protected:
 	// Types
 	typedef std::map<std::string, std::string> StringMap;
@@ -0,0 +1,105 @@
+// Module:  Log4CPLUS
+// File:    retention.h
+
+#ifndef LOG4CPLUS_RETENTION_HEADER_
+#define LOG4CPLUS_RETENTION_HEADER_
+
+
+#include "log4cplus/platform.h"
+#include "log4cplus/mutex.h"
+#include "log4cplus/thread.h"
+
+#include <ctime>
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+class DirectoryScan;
+
+
+/**
+* Deletes old rolled log files in the background. A log family is the
+* set of files next to a log file whose names start with the log file's
+* name and a dot, e.g. <code>app.log.1</code> or
+* <code>app.log.2009-11-07</code>; the log file itself is never deleted.
+* While the family (log file included) is larger than its
+* <b>MaxTotalSize</b>, or its oldest file was last written more than
+* <b>MaxAgeDays</b> ago, the oldest file is deleted.
+*
+* The directory is read once, a bounded number of entries at a time, and
+* the family is kept in memory from then on: after a rollover the
+* appender reports the names it wrote and only those and the known files
+* are looked at again. Ages are checked once a minute.
+*/
+class LOG4CPLUS_EXPORT RetentionManager : private Thread
+{
+public:
+	static RetentionManager& getInstance();
+
+	/**
+	* Starts managing the family of <code>filename</code>; zero for
+	* <code>maxTotalSize</code> or <code>maxAgeDays</code> means no limit.
+	* Returns the id to pass to the other methods.
+	*/
+	unsigned int addFamily(const std::string& filename, long long maxTotalSize, unsigned int maxAgeDays);
+
+	void removeFamily(unsigned int id);
+
+	//! Called after a rollover with the paths the appender renamed files to.
+	void rolled(unsigned int id, const std::vector<std::string>& paths);
+
+private:
+	struct FileEntry
+	{
+		long long size;
+		std::time_t mtime;
+		long mtimeNanos;
+	};
+
+	struct Family
+	{
+		std::string directory;
+		std::string baseName;
+		long long maxTotalSize;
+		unsigned int maxAgeDays;
+		std::map<std::string, FileEntry> files;
+		std::vector<std::string> reported;
+		DirectoryScan* scan;		// until the directory was read
+		bool isChanged;
+	};
+
+	typedef std::map<unsigned int, Family> Families;
+
+	RetentionManager();
+	virtual ~RetentionManager();
+
+	virtual void run();
+
+	//! Does a bounded amount of work; returns <code>true</code> if more is left.
+	bool processStep(bool isAgeCheckDue);
+	bool scanStep(Family& family);
+	void restat(Family& family);
+	void enforce(Family& family);
+	void stop();
+
+	Mutex _mutex;
+	Families _families;
+	unsigned int _nextId;
+
+	ManualResetEvent _wakeup;
+	volatile AtomicInt _stopping;
+
+	// Disable copy
+	RetentionManager(const RetentionManager&);
+	RetentionManager& operator=(const RetentionManager&);
+};
+
+
+} // namespace log4cplus
+
+
+#endif // LOG4CPLUS_RETENTION_HEADER_
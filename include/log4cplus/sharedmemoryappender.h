@@ -0,0 +1,120 @@
+// Module:  Log4CPLUS
+// File:    sharedmemoryappender.h
+
+#ifndef LOG4CPLUS_SHARED_MEMORY_APPENDER_HEADER_
+#define LOG4CPLUS_SHARED_MEMORY_APPENDER_HEADER_
+
+
+#include "log4cplus/platform.h"
+#include "log4cplus/appender.h"
+#include "log4cplus/atomic.h"
+
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+struct ShmRingHeader;
+
+
+/**
+* Writes formatted events into a ring buffer in POSIX shared memory,
+* <code>/dev/shm/log4cplus.&lt;Name&gt;.&lt;pid&gt;</code>, to be picked
+* up by a SharedMemoryCollector in another process.
+*
+* Each process has its own single-producer/single-consumer ring, so
+* append() takes no lock besides the appender's own, never touches
+* the disk and never waits for the collector: when the ring is full the
+* event is dropped and counted. Published events stay in shared memory
+* when the process dies and are collected afterwards.
+*
+* <h3>Properties</h3>
+* <dl>
+* <dt><tt>Name</tt></dt>
+* <dd>Name shared by the writers and their collector, <code>default</code>
+* by default.</dd>
+* <dt><tt>Size</tt></dt>
+* <dd>Ring size in bytes, rounded up to a power of two, 1 MB by
+* default.</dd>
+* </dl>
+*
+* Not available on Windows.
+*/
+class LOG4CPLUS_EXPORT SharedMemoryAppender : public Appender
+{
+public:
+	SharedMemoryAppender(const std::string& name, unsigned long size = 1024 * 1024);
+	SharedMemoryAppender(const Properties& properties);
+	virtual ~SharedMemoryAppender();
+
+	virtual void close();
+
+	//! Number of events dropped because the ring was full.
+	AtomicInt64 getDroppedCount() const;
+
+protected:
+	virtual void append(const InternalLoggingEvent& loggingEvent);
+
+private:
+	void init(const std::string& name, unsigned long size);
+
+	std::string _shmName;
+	ShmRingHeader* _ring;
+	unsigned long _mappedSize;
+	mutable volatile AtomicInt64 _dropped;
+
+	SharedMemoryAppender(const SharedMemoryAppender&);
+	SharedMemoryAppender& operator= (const SharedMemoryAppender&);
+};
+
+
+/**
+* Reads the rings of all SharedMemoryAppenders sharing a name and hands
+* their events to an appender, e.g. a RollingFileAppender with the
+* PatternLayout <code>%m</code> to write the text formatted by the
+* workers unchanged.
+*
+* Every poll() merges the events available in all rings by timestamp.
+* Rings of processes that no longer exist are removed once drained.
+*/
+class LOG4CPLUS_EXPORT SharedMemoryCollector
+{
+public:
+	SharedMemoryCollector(const std::string& name, SharedAppenderPtr target);
+	~SharedMemoryCollector();
+
+	/**
+	* Picks up new rings, forwards all pending events and returns how
+	* many were forwarded.
+	*/
+	size_t poll();
+
+	//! Sum of the events the writers of the attached rings have dropped.
+	AtomicInt64 getDroppedCount() const;
+
+private:
+	struct Ring
+	{
+		std::string shmName;
+		ShmRingHeader* header;
+		unsigned long mappedSize;
+	};
+
+	void scanForRings();
+	void detach(Ring& ring, bool removeShm);
+
+	std::string _prefix;
+	SharedAppenderPtr _target;
+	std::vector<Ring> _rings;
+
+	SharedMemoryCollector(const SharedMemoryCollector&);
+	SharedMemoryCollector& operator= (const SharedMemoryCollector&);
+};
+
+
+} // namespace log4cplus
+
+
+#endif // LOG4CPLUS_SHARED_MEMORY_APPENDER_HEADER_
@@ -22,7 +22,7 @@ class LOG4CPLUS_EXPORT ReferenceCounter
 	/// Simple ReferenceCounter object, does not delete itself when count reaches 0.
 {
 public:
-	ReferenceCounter(): _cnt(1)
+	ReferenceCounter(): _cnt(1), _mutex("ReferenceCounter")
 	{
 	}
 
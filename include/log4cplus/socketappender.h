@@ -0,0 +1,128 @@
+// Module:  Log4CPLUS
+// File:    socketappender.h
+
+#ifndef LOG4CPLUS_SOCKET_APPENDER_HEADER_
+#define LOG4CPLUS_SOCKET_APPENDER_HEADER_
+
+
+#include "log4cplus/platform.h"
+#include "log4cplus/appender.h"
+#include "log4cplus/atomic.h"
+#include "log4cplus/mutex.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/timehelper.h"
+
+#include <string>
+#include <vector>
+
+
+namespace log4cplus {
+
+
+/**
+* Sends log events to a local syslog daemon or a collector, over a Unix
+* domain datagram or stream socket or over UDP.
+*
+* append() only formats the event and queues it; a background thread
+* sends the queue in batches (<code>sendmmsg()</code> for datagrams, one
+* gathering <code>sendmsg()</code> for streams), so a slow or missing peer
+* never blocks the logging thread. While the peer is unreachable the
+* thread retries after <b>ReopenDelay</b> seconds, doubling the delay up
+* to <b>MaxReopenDelay</b>. Events beyond <b>QueueLimit</b> are dropped
+* and counted.
+*
+* <h3>Properties</h3>
+* <dl>
+* <dt><tt>Protocol</tt></dt>
+* <dd><code>unix-dgram</code> (default), <code>unix-stream</code> or
+* <code>udp</code>.</dd>
+* <dt><tt>Path</tt></dt>
+* <dd>Socket path for the Unix protocols, <code>/dev/log</code> by
+* default.</dd>
+* <dt><tt>Host</tt>, <tt>Port</tt></dt>
+* <dd>Numeric IPv4 address (default <code>127.0.0.1</code>) and port
+* (default 514) for UDP.</dd>
+* <dt><tt>Facility</tt></dt>
+* <dd>When set (<code>user</code>, <code>daemon</code>,
+* <code>local0</code>...) every message starts with a syslog
+* <code>&lt;PRI&gt;</code> header, followed by <tt>Ident</tt> and a
+* colon when <tt>Ident</tt> is set.</dd>
+* <dt><tt>BatchSize</tt></dt>
+* <dd>Most events sent by one system call, 64 by default.</dd>
+* <dt><tt>QueueLimit</tt></dt>
+* <dd>Most events waiting to be sent, 10000 by default.</dd>
+* <dt><tt>ReopenDelay</tt>, <tt>MaxReopenDelay</tt></dt>
+* <dd>Initial and largest reconnection delay in seconds, 1 and 60 by
+* default.</dd>
+* </dl>
+*
+* Each event is one datagram; on stream sockets events are terminated
+* by a line feed. Trailing line feeds and NULs of the layout output are
+* removed.
+*/
+class LOG4CPLUS_EXPORT SocketAppender : public Appender, private Thread
+{
+public:
+	enum Protocol { UNIX_DGRAM, UNIX_STREAM, UDP };
+
+	SocketAppender(Protocol protocol, const std::string& address, unsigned short port = 514);
+	SocketAppender(const Properties& properties);
+	virtual ~SocketAppender();
+
+	virtual void close();
+
+	//! Number of events dropped because the queue was full or unsendable.
+	AtomicInt64 getDroppedCount() const;
+
+protected:
+	virtual void append(const InternalLoggingEvent& loggingEvent);
+
+private:
+#ifdef _MSC_VER
+	typedef SOCKET SocketType;
+#else
+	typedef int SocketType;
+#endif
+
+	void init();
+	virtual void run();
+	bool connectSocket();
+	void closeSocket();
+	bool sendPending(std::vector<std::string>& pending);
+	void scheduleReconnect();
+	void dropOldest(std::vector<std::string>& pending);
+
+	Protocol _protocol;
+	std::string _path;
+	std::string _host;
+	unsigned short _port;
+	int _facility;
+	std::string _ident;
+	unsigned int _batchSize;
+	unsigned int _queueLimit;
+	int _reopenDelay;
+	int _maxReopenDelay;
+
+	Mutex _queueMutex;
+	std::vector<std::string> _queue;
+	ManualResetEvent _wakeup;
+	volatile AtomicInt _stopping;
+	mutable volatile AtomicInt64 _dropped;
+
+	// Owned by the sender thread.
+	SocketType _socket;
+	int _currentDelay;
+	TimeHelper _reconnectTime;
+
+	SocketAppender(const SocketAppender&);
+	SocketAppender& operator= (const SocketAppender&);
+};
+
+
+typedef SharedPtr<SocketAppender> SharedSocketAppenderPtr;
+
+
+} // namespace log4cplus
+
+
+#endif // LOG4CPLUS_SOCKET_APPENDER_HEADER_
@@ -33,11 +33,51 @@ namespace log4cplus {
 	
 	std::string convertIntegerToString(int intValue);
 
+	//! Appends the decimal digits of <code>value</code> to <code>result</code>.
+	LOG4CPLUS_EXPORT void appendIntegerToString(std::string& result, long long value);
+	LOG4CPLUS_EXPORT void appendUnsignedToString(std::string& result, unsigned long long value);
+
 	//!Join a list of items into a string.
 	typedef std::vector<std::string, std::allocator<std::string> >::iterator Iterator;
 
 	void join(std::string& result, Iterator start, Iterator last, std::string const& sep);
 
+	/**
+	* Appends the <code>length</code> bytes at <code>s</code> to
+	* <code>result</code> as the contents of a JSON string. Runs of bytes
+	* needing no escape are copied at once; quotes, backslashes and
+	* control characters are escaped. Other bytes, including UTF-8
+	* sequences, are copied unchanged.
+	*/
+	LOG4CPLUS_EXPORT void appendJsonEscaped(std::string& result, const char* s, std::size_t length);
+
+
+	/**
+	* Substring search for a needle fixed up front, e.g. by a filter at
+	* construction time. Candidates are located 32 bytes at a time by
+	* comparing the first and last byte of the needle with SSE2, and only
+	* those are verified with memcmp. Without SSE2 the first byte is
+	* located with memchr.
+	*/
+	class LOG4CPLUS_EXPORT StringSearcher
+	{
+	public:
+		explicit StringSearcher(const std::string& needle = std::string());
+
+		const std::string& getNeedle() const { return _needle; }
+
+		//! Returns the position of the first match or std::string::npos.
+		std::size_t find(const char* haystack, std::size_t length) const;
+
+		std::size_t find(const std::string& haystack) const
+		{
+			return find(haystack.data(), haystack.size());
+		}
+
+	private:
+		std::string _needle;
+	};
+
 } // namespace log4cplus 
 
 #endif // LOG4CPLUS_HELPERS_STRINGHELPER_HEADER_
@@ -0,0 +1,94 @@
+// Module:  Log4CPLUS
+// File:    thread.h
+
+#ifndef LOG4CPLUS_THREAD_H_
+#define LOG4CPLUS_THREAD_H_
+
+#include "log4cplus/platform.h"
+#include "log4cplus/mutex.h"
+
+
+namespace log4cplus {
+
+
+#ifdef _MSC_VER
+	typedef HANDLE ThreadHandle;
+#else	//__linux__
+	typedef pthread_t ThreadHandle;
+#endif
+
+
+/**
+* Base class of the library's background threads. Subclasses implement
+* run(); start() launches it and join() waits for it to return. The
+* thread's log4cplus per thread data is released when run() returns.
+*/
+class LOG4CPLUS_EXPORT Thread
+{
+public:
+	Thread();
+	virtual ~Thread();
+
+	//! Returns <code>false</code> if the thread could not be created.
+	bool start();
+
+	//! Waits for run() to return. Does nothing if the thread is not started.
+	void join();
+
+	bool isStarted() const { return _isStarted; }
+
+protected:
+	virtual void run() = 0;
+
+private:
+#ifdef _MSC_VER
+	static unsigned __stdcall threadProc(void* arg);
+#else
+	static void* threadProc(void* arg);
+#endif
+
+	ThreadHandle _handle;
+	bool _isStarted;
+
+	Thread(const Thread&);
+	Thread& operator= (const Thread&);
+};
+
+
+/**
+* An event that stays signalled until reset(), used to wake up and stop
+* background threads.
+*/
+class LOG4CPLUS_EXPORT ManualResetEvent
+{
+public:
+	explicit ManualResetEvent(bool signalled = false);
+	~ManualResetEvent();
+
+	void signal();
+	void reset();
+	void wait();
+
+	/**
+	* Waits at most <code>millis</code> milliseconds. Returns
+	* <code>true</code> if the event is signalled.
+	*/
+	bool timedWait(unsigned long millis);
+
+private:
+#ifdef _MSC_VER
+	HANDLE _event;
+#else
+	pthread_mutex_t _mutex;
+	pthread_cond_t _cond;
+	bool _signalled;
+#endif
+
+	ManualResetEvent(const ManualResetEvent&);
+	ManualResetEvent& operator= (const ManualResetEvent&);
+};
+
+
+}  // namespace log4cplus
+
+#endif  // LOG4CPLUS_THREAD_H_
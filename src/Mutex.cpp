@@ -1,30 +1,176 @@
 
 #include <stdlib.h>      // for abort()
+#include <string.h>
+
+#include <ostream>
 
 #include "log4cplus/mutex.h"
 
+#ifndef _MSC_VER
+#include <sys/time.h>
+#endif
+
 using namespace log4cplus;
 
+#ifdef LOG4CPLUS_MUTEX_STATS
+
+// The registry is guarded by a spin lock so that it can be used from
+// static constructors, before any Mutex is guaranteed to exist.
+static volatile AtomicInt s_statsLock = 0;
+static MutexStats* s_statsHead = 0;
+
+static void lockStatsRegistry()
+{
+	while(atomicCompareExchange(&s_statsLock, 0, 1) != 0)
+		;
+}
+
+static void unlockStatsRegistry()
+{
+	atomicExchange(&s_statsLock, 0);
+}
+
+static MutexStats* findMutexStats(const char* name)
+{
+	if(name == 0)
+		name = "unnamed";
+
+	lockStatsRegistry();
+
+	MutexStats* stats = s_statsHead;
+	while(stats && strcmp(stats->name, name) != 0)
+		stats = stats->next;
+
+	if(stats == 0)
+	{
+		// Never freed: mutexes may still be locked during static destruction.
+		stats = new MutexStats;
+		stats->name = name;
+		stats->acquisitions = 0;
+		stats->contentions = 0;
+		stats->waitMicros = 0;
+		stats->next = s_statsHead;
+		s_statsHead = stats;
+	}
+
+	unlockStatsRegistry();
+	return stats;
+}
+
+static AtomicInt64 nowMicros()
+{
+#ifdef _MSC_VER
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return count.QuadPart * 1000000 / freq.QuadPart;
+#else
+	struct timeval tv;
+	::gettimeofday(&tv, 0);
+	return static_cast<AtomicInt64>(tv.tv_sec) * 1000000 + tv.tv_usec;
+#endif
+}
+
+void Mutex::dumpStats(std::ostream& os)
+{
+	lockStatsRegistry();
+	MutexStats* head = s_statsHead;
+	unlockStatsRegistry();
+
+	// Entries are only ever prepended, so the list is safe to walk
+	// without holding the registry lock.
+	os << "mutex acquisitions contended wait_us\n";
+	for(MutexStats* stats = head; stats; stats = stats->next)
+	{
+		os << stats->name
+			<< ' ' << atomicLoad64(&stats->acquisitions)
+			<< ' ' << atomicLoad64(&stats->contentions)
+			<< ' ' << atomicLoad64(&stats->waitMicros)
+			<< '\n';
+	}
+}
+
+void Mutex::resetStats()
+{
+	lockStatsRegistry();
+	for(MutexStats* stats = s_statsHead; stats; stats = stats->next)
+	{
+		atomicAdd64(&stats->acquisitions, -atomicLoad64(&stats->acquisitions));
+		atomicAdd64(&stats->contentions, -atomicLoad64(&stats->contentions));
+		atomicAdd64(&stats->waitMicros, -atomicLoad64(&stats->waitMicros));
+	}
+	unlockStatsRegistry();
+}
+
+#else
+
+void Mutex::dumpStats(std::ostream& os)
+{
+	os << "mutex statistics disabled (build with LOG4CPLUS_MUTEX_STATS)\n";
+}
+
+void Mutex::resetStats() {}
+
+#endif
+
 #ifdef _MSC_VER
 
-Mutex::Mutex()             { InitializeCriticalSection(&_mutex); }
+#ifdef LOG4CPLUS_MUTEX_STATS
+Mutex::Mutex(const char* name) : _stats(findMutexStats(name)) { InitializeCriticalSection(&_mutex); }
+#else
+Mutex::Mutex(const char*) : _stats(0) { InitializeCriticalSection(&_mutex); }
+#endif
 Mutex::~Mutex()            { DeleteCriticalSection(&_mutex); }
-void Mutex::Lock()         { EnterCriticalSection(&_mutex); }
 void Mutex::Unlock()       { LeaveCriticalSection(&_mutex); }
 
+#ifdef LOG4CPLUS_MUTEX_STATS
+void Mutex::Lock()
+{
+	if(!TryEnterCriticalSection(&_mutex))
+	{
+		AtomicInt64 start = nowMicros();
+		EnterCriticalSection(&_mutex);
+		atomicAdd64(&_stats->contentions, 1);
+		atomicAdd64(&_stats->waitMicros, nowMicros() - start);
+	}
+	atomicAdd64(&_stats->acquisitions, 1);
+}
+#else
+void Mutex::Lock()         { EnterCriticalSection(&_mutex); }
+#endif
+
 #else
 
 #define SAFE_PTHREAD(fncall)  do {    \
 	if (fncall(&_mutex) != 0) abort();  \
 } while (0)
 
-Mutex::Mutex()             
+#ifdef LOG4CPLUS_MUTEX_STATS
+Mutex::Mutex(const char* name) : _stats(findMutexStats(name))
+#else
+Mutex::Mutex(const char*) : _stats(0)
+#endif
 {
 	if (pthread_mutex_init(&_mutex, NULL) != 0) abort();
 }
 Mutex::~Mutex()            { SAFE_PTHREAD(pthread_mutex_destroy); }
-void Mutex::Lock()         { SAFE_PTHREAD(pthread_mutex_lock); }
 void Mutex::Unlock()       { SAFE_PTHREAD(pthread_mutex_unlock); }
+
+#ifdef LOG4CPLUS_MUTEX_STATS
+void Mutex::Lock()
+{
+	if(pthread_mutex_trylock(&_mutex) != 0)
+	{
+		AtomicInt64 start = nowMicros();
+		SAFE_PTHREAD(pthread_mutex_lock);
+		atomicAdd64(&_stats->contentions, 1);
+		atomicAdd64(&_stats->waitMicros, nowMicros() - start);
+	}
+	atomicAdd64(&_stats->acquisitions, 1);
+}
+#else
+void Mutex::Lock()         { SAFE_PTHREAD(pthread_mutex_lock); }
+#endif
 #undef SAFE_PTHREAD
 
-#endif
\ No newline at end of file
+#endif
@@ -9,12 +9,14 @@
 #include "log4cplus/property.h"
 #include "log4cplus/factory.h"
 #include "log4cplus/loggingevent.h"
+#include "log4cplus/appenderattachableimpl.h"
 
 #include <stdexcept>
 
 using namespace std;
 using namespace log4cplus;
 
+
 ErrorHandler::ErrorHandler() {}
 
 ErrorHandler::~ErrorHandler() {}
@@ -44,19 +46,27 @@ void OnlyOnceErrorHandler::reset()
 
 Appender::Appender()
 	: _layout(new SimpleLayout()),
+	_layoutShareId(log4cplus::getLayoutShareId(_layout->getFormatKey())),
 	_name(""),
 	_threshold(NOT_SET_LOG_LEVEL),
+	_levelVerdictsValid(false),
 	_errorHandler(new OnlyOnceErrorHandler),
-	_isClosed(false)
+	_isClosed(false),
+	_isAppendUnlocked(false),
+	_mutex("Appender")
 {
 }
 
 Appender::Appender(const log4cplus::Properties & properties)
 	: _layout(new SimpleLayout())
+	, _layoutShareId(log4cplus::getLayoutShareId(_layout->getFormatKey()))
 	, _name()
 	, _threshold(NOT_SET_LOG_LEVEL)
+	, _levelVerdictsValid(false)
 	, _errorHandler(new OnlyOnceErrorHandler)
 	, _isClosed(false)
+	, _isAppendUnlocked(false)
+	, _mutex("Appender")
 {
 	if(properties.exists("layout"))
 	{
@@ -79,6 +89,7 @@ Appender::Appender(const log4cplus::Properties & properties)
 			else 
 			{
 				_layout = newLayout;
+				_layoutShareId = log4cplus::getLayoutShareId(_layout->getFormatKey());
 			}
 		}
 		catch(std::exception const& e) 
@@ -154,6 +165,25 @@ bool Appender::isClosed() const
 
 void Appender::doAppend(const log4cplus::InternalLoggingEvent& loggingEvent)
 {
+	// Neither the threshold nor the verdict table change once
+	// configured, so they can be read unlocked.
+	LogLevel const level = loggingEvent.getLogLevel();
+	bool const isLevelVerdict = _levelVerdictsValid && level >= 0 && level <= OFF_LOG_LEVEL && level % 10000 == 0;
+	if(_isAppendUnlocked && (isLevelVerdict || !_filter.get()))
+	{
+		if(_isClosed)
+		{
+			LogLog::getLogLog()->error("Attempted to append to closed appender named [" + _name + "].");
+			return;
+		}
+
+		if(!isAsSevereAsThreshold(level) || (isLevelVerdict && _levelVerdicts[level / 10000] == DENY))
+			return;
+
+		appendUnlocked(loggingEvent);
+		return;
+	}
+
 	MutexLock lock(&_mutex);
 
 	if(_isClosed) 
@@ -167,9 +197,26 @@ void Appender::doAppend(const log4cplus::InternalLoggingEvent& loggingEvent)
 	if(!isAsSevereAsThreshold(loggingEvent.getLogLevel()))
 		return;
 
-	// Evaluate filters attached to this appender.
+	// Evaluate filters attached to this appender. A chain of LogLevel
+	// filters was reduced to a table by setFilter(); such filters never
+	// queue events of their own.
+
+	LogLevel const ll = loggingEvent.getLogLevel();
+	if(_levelVerdictsValid && ll >= 0 && ll <= OFF_LOG_LEVEL && ll % 10000 == 0)
+	{
+		if(_levelVerdicts[ll / 10000] == DENY)
+			return;
 
-	if(checkFilter(_filter.get(), loggingEvent) == DENY)
+		append(loggingEvent);
+		return;
+	}
+
+	FilterResult const result = checkFilter(_filter.get(), loggingEvent);
+
+	// Events generated by the filters go out before the current one.
+	appendPendingEvents();
+
+	if(result == DENY)
 		return;
 	// Finally append given loggingEvent.
 
@@ -177,6 +224,85 @@ void Appender::doAppend(const log4cplus::InternalLoggingEvent& loggingEvent)
 }
 
 
+void Appender::appendUnlocked(const InternalLoggingEvent& loggingEvent)
+{
+	MutexLock lock(&_mutex);
+
+	if(!_isClosed)
+		append(loggingEvent);
+}
+
+
+void Appender::setFilter(FilterPtr f)
+{
+	_filter = f;
+	compileFilter();
+}
+
+
+void Appender::compileFilter()
+{
+	_levelVerdictsValid = false;
+	if(!_filter)
+		return;
+
+	for(int i = 0; i < LEVEL_VERDICTS; ++i)
+	{
+		LogLevel const ll = static_cast<LogLevel>(i * 10000);
+		FilterResult result = NEUTRAL;
+		for(const Filter* filter = _filter.get(); filter && result == NEUTRAL; filter = filter->_nextFilter.get())
+		{
+			if(!filter->decideLevel(ll, result))
+				return;
+		}
+
+		_levelVerdicts[i] = result == NEUTRAL ? ACCEPT : result;
+	}
+
+	_levelVerdictsValid = true;
+}
+
+
+void Appender::appendPendingEvents()
+{
+	for(const Filter* filter = _filter.get(); filter; filter = filter->_nextFilter.get())
+	{
+		if(!filter->hasPendingEvents())
+			continue;
+
+		InternalLoggingEvent pending;
+		while(filter->nextPendingEvent(pending))
+			append(pending);
+	}
+}
+
+
+const string& Appender::formatEvent(const InternalLoggingEvent& loggingEvent)
+{
+	bool isNew = true;
+	string* text = _layoutShareId != 0 ? loggingEvent.getSharedFormat(_layoutShareId, isNew) : NULL;
+	if(!text)
+		text = &_formatBuffer;
+
+	if(isNew)
+	{
+		text->clear();
+		if(_layout.get())
+		{
+			_formatSink.setTarget(text);
+			_layout->format(_formatSink, loggingEvent);
+		}
+	}
+
+	return *text;
+}
+
+
+void Appender::flush()
+{
+}
+
+
 string Appender::getName()
 {
 	return _name;
@@ -212,6 +338,10 @@ void Appender::setLayout(std::auto_ptr<Layout> lo)
 	MutexLock lock(&_mutex);
 
 	this->_layout = lo;
+	_layoutShareId = _layout.get() ? log4cplus::getLayoutShareId(_layout->getFormatKey()) : 0;
+
+	// The loggers reading this appender recompute which appenders share.
+	AppenderAttachableImpl::notifyChange();
 }
 
 Layout* Appender::getLayout()
@@ -16,7 +16,10 @@ using namespace log4cplus;
 AppenderAttachable::~AppenderAttachable() {}
 
 
-AppenderAttachableImpl::AppenderAttachableImpl() {}
+volatile AtomicInt AppenderAttachableImpl::s_changeCount = 0;
+
+
+AppenderAttachableImpl::AppenderAttachableImpl() : appender_list_mutex("appender_list_mutex") {}
 
 
 AppenderAttachableImpl::~AppenderAttachableImpl() {}
@@ -36,6 +39,7 @@ void AppenderAttachableImpl::addAppender(SharedAppenderPtr newAppender)
 	if(it == _appenderList.end()) 
 	{
 		_appenderList.push_back(newAppender);
+		notifyChange();
 	}
 }
 
@@ -69,6 +73,7 @@ void AppenderAttachableImpl::removeAllAppenders()
 	MutexLock lock(&appender_list_mutex);
 
 	_appenderList.erase(_appenderList.begin(), _appenderList.end());
+	notifyChange();
 }
 
 
@@ -88,6 +93,7 @@ void AppenderAttachableImpl::removeAppender(SharedAppenderPtr appender)
 	if(it != _appenderList.end()) 
 	{
 		_appenderList.erase(it);
+		notifyChange();
 	}
 }
 
@@ -98,6 +104,25 @@ void AppenderAttachableImpl::removeAppender(const string& name)
 }
 
 
+void AppenderAttachableImpl::setAppenders(const SharedAppenderPtrList& appenders)
+{
+	ListType newList;
+	for(ListType::const_iterator it = appenders.begin(); it != appenders.end(); ++it)
+	{
+		if(*it && std::find(newList.begin(), newList.end(), *it) == newList.end())
+			newList.push_back(*it);
+	}
+
+	{
+		MutexLock lock(&appender_list_mutex);
+		_appenderList.swap(newList);
+		notifyChange();
+	}
+
+	// The previous list is released here, outside the lock.
+}
+
+
 int AppenderAttachableImpl::appendLoopOnAppenders(const InternalLoggingEvent& loggingEvent) const
 {
 	int count = 0;
@@ -0,0 +1,121 @@
+// Module:  Log4CPLUS
+// File:    bytesink.cpp
+
+#include "log4cplus/bytesink.h"
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ByteSink
+///////////////////////////////////////////////////////////////////////////////
+
+ByteSink::ByteSink() {}
+
+ByteSink::~ByteSink() {}
+
+
+char* ByteSink::reserve(size_t length)
+{
+	if(_reserved.size() < length)
+		_reserved.resize(length);
+	return _reserved.empty() ? NULL : &_reserved[0];
+}
+
+
+void ByteSink::commit(size_t length)
+{
+	if(length > 0)
+		append(&_reserved[0], length);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// StringByteSink
+///////////////////////////////////////////////////////////////////////////////
+
+StringByteSink::StringByteSink(string* target) : _target(target), _reservedAt(0) {}
+
+StringByteSink::~StringByteSink() {}
+
+
+void StringByteSink::append(const char* data, size_t length)
+{
+	_target->append(data, length);
+}
+
+
+char* StringByteSink::reserve(size_t length)
+{
+	_reservedAt = _target->size();
+	_target->resize(_reservedAt + length);
+	return length > 0 ? &(*_target)[_reservedAt] : NULL;
+}
+
+
+void StringByteSink::commit(size_t length)
+{
+	_target->resize(_reservedAt + length);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// OStreamByteSink
+///////////////////////////////////////////////////////////////////////////////
+
+OStreamByteSink::OStreamByteSink(ostream& output) : _output(output) {}
+
+OStreamByteSink::~OStreamByteSink() {}
+
+
+void OStreamByteSink::append(const char* data, size_t length)
+{
+	_output.write(data, static_cast<streamsize>(length));
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ByteSinkStream
+///////////////////////////////////////////////////////////////////////////////
+
+// The stream starts without a buffer, as the member is built after the
+// base class.
+ByteSinkStream::ByteSinkStream(ByteSink* sink) : std::ostream(NULL)
+{
+	_buffer._sink = sink;
+	rdbuf(&_buffer);
+}
+
+ByteSinkStream::~ByteSinkStream() {}
+
+
+void ByteSinkStream::setSink(ByteSink* sink)
+{
+	_buffer._sink = sink;
+	clear();
+}
+
+
+ByteSinkStream::Buffer::int_type ByteSinkStream::Buffer::overflow(int_type c)
+{
+	if(traits_type::eq_int_type(c, traits_type::eof()))
+		return traits_type::not_eof(c);
+
+	if(!_sink)
+		return traits_type::eof();
+
+	_sink->append(traits_type::to_char_type(c));
+	return c;
+}
+
+
+streamsize ByteSinkStream::Buffer::xsputn(const char* s, streamsize n)
+{
+	if(!_sink)
+		return 0;
+
+	_sink->append(s, static_cast<size_t>(n));
+	return n;
+}
@@ -12,6 +12,10 @@
 #include "log4cplus/environment.h"
 
 #include <iterator>
+#include <set>
+
+#include <sys/types.h>
+#include <sys/stat.h>
 
 
 using namespace std;
@@ -100,6 +104,30 @@ void PropertyConfigurator::configureLoggers()
 		Logger log = getLogger(*it);
 		configureLogger(log, loggerProperties.getProperty(*it));
 	}
+
+	configureAdditivity();
+}
+
+
+void PropertyConfigurator::configureAdditivity()
+{
+	Properties additivityProperties = _properties.getPropertySubset("additivity.");
+	vector<string> const names = additivityProperties.propertyNames();
+
+	for(vector<string>::const_iterator it = names.begin(); it != names.end(); ++it)
+	{
+		bool additivity = true;
+		if(!additivityProperties.getBool(additivity, *it))
+		{
+			LogLog::getLogLog()->error(
+				"PropertyConfigurator::configureAdditivity()- Invalid additivity for logger " + *it);
+			continue;
+		}
+
+		Logger logger = getLogger(*it);
+		if(logger.getAdditivity() != additivity)
+			logger.setAdditivity(additivity);
+	}
 }
 
 
@@ -128,10 +156,9 @@ void PropertyConfigurator::configureLogger(Logger logger, const string& config)
 	else
 		logger.setLogLevel(NOT_SET_LOG_LEVEL);
 
-	// Remove all existing appenders first so that we do not duplicate output.
-	logger.removeAllAppenders();
-
-	// Set the Appenders
+	// Set the Appenders. The previous ones are replaced in one step so that
+	// we neither duplicate nor lose output meanwhile.
+	SharedAppenderPtrList appenders;
 	for(vector<string>::size_type j=1; j < tokens.size(); ++j)
 	{
 		AppenderMap::iterator appenderIt = _appenders.find(tokens[j]);
@@ -141,63 +168,141 @@ void PropertyConfigurator::configureLogger(Logger logger, const string& config)
 				"PropertyConfigurator::configureLogger()- Invalid appender: " + tokens[j]);
 			continue;
 		}
-		addAppender(logger, appenderIt->second);
+		appenders.push_back(appenderIt->second);
 	}
+	logger.setAppenders(appenders);
 }
 
 
 void PropertyConfigurator::configureAppenders()
+{
+	configureAppenders(Properties(), AppenderMap());
+}
+
+
+void PropertyConfigurator::configureAppenders(const Properties& previous, const AppenderMap& reusable)
 {
 	Properties appenderProperties = _properties.getPropertySubset("appender.");
+	Properties previousAppenderProperties = previous.getPropertySubset("appender.");
 	vector<string> appendersProps = appenderProperties.propertyNames();
-	string factoryName;
 
 	for(vector<string>::iterator it=appendersProps.begin(); it != appendersProps.end(); ++it)
 	{
 		if( it->find('.') == string::npos )
 		{
-			factoryName = appenderProperties.getProperty(*it);
-			AppenderFactory* factory = getAppenderFactoryRegistry().get(factoryName);
-			if(!factory)
+			AppenderMap::const_iterator reusableIt = reusable.find(*it);
+			if(reusableIt != reusable.end()
+				&& previousAppenderProperties.getProperty(*it) == appenderProperties.getProperty(*it)
+				&& previousAppenderProperties.getPropertySubset((*it) + ".") == appenderProperties.getPropertySubset((*it) + "."))
 			{
-				string err = "PropertyConfigurator::configureAppenders()- Cannot find AppenderFactory: ";
-				LogLog::getLogLog()->error(err + factoryName);
+				_appenders[*it] = reusableIt->second;
 				continue;
 			}
 
-			Properties props_subset = appenderProperties.getPropertySubset((*it) + ".");
-			try
-			{
-				SharedAppenderPtr appender = factory->createObject(props_subset);
-				if(!appender)
-				{
-					string err ="PropertyConfigurator::configureAppenders() - Failed to create appender: ";
-					LogLog::getLogLog()->error(err + *it);
-				}
-				else
-				{
-					appender->setName(*it);
-					_appenders[*it] = appender;
-				}
-			}
-			catch(std::exception const& e)
-			{
-				string err = "PropertyConfigurator::configureAppenders() - Error while creating Appender: ";
-				LogLog::getLogLog()->error(err + string(e.what()));
-			}
+			SharedAppenderPtr appender = createAppender(*it, appenderProperties);
+			if(appender)
+				_appenders[*it] = appender;
 		}
 	} // end for loop
 }
 
-Logger PropertyConfigurator::getLogger(const string& name)
+
+SharedAppenderPtr PropertyConfigurator::createAppender(const string& name, const Properties& appenderProperties)
 {
-	return _hierarchy.getInstance(name);
+	string const& factoryName = appenderProperties.getProperty(name);
+	AppenderFactory* factory = getAppenderFactoryRegistry().get(factoryName);
+	if(!factory)
+	{
+		string err = "PropertyConfigurator::configureAppenders()- Cannot find AppenderFactory: ";
+		LogLog::getLogLog()->error(err + factoryName);
+		return SharedAppenderPtr();
+	}
+
+	Properties props_subset = appenderProperties.getPropertySubset(name + ".");
+	try
+	{
+		SharedAppenderPtr appender = factory->createObject(props_subset);
+		if(!appender)
+		{
+			string err ="PropertyConfigurator::configureAppenders() - Failed to create appender: ";
+			LogLog::getLogLog()->error(err + name);
+		}
+		else
+		{
+			appender->setName(name);
+		}
+		return appender;
+	}
+	catch(std::exception const& e)
+	{
+		string err = "PropertyConfigurator::configureAppenders() - Error while creating Appender: ";
+		LogLog::getLogLog()->error(err + string(e.what()));
+	}
+	return SharedAppenderPtr();
 }
 
 
-void PropertyConfigurator::addAppender(Logger& logger, SharedAppenderPtr& appender)
+void PropertyConfigurator::reconfigure(const Properties& previous)
 {
-	logger.addAppender(appender);
+	initializeLog4cplus();
+
+	// Collect the appenders of the previous configuration that are
+	// still attached to some logger.
+	Properties previousAppenderProperties = previous.getPropertySubset("appender.");
+	LoggerList loggers = _hierarchy.getCurrentLoggers();
+	loggers.push_back(_hierarchy.getRoot());
+
+	AppenderMap previousAppenders;
+	for(LoggerList::iterator it = loggers.begin(); it != loggers.end(); ++it)
+	{
+		SharedAppenderPtrList appenders = it->getAllAppenders();
+		for(SharedAppenderPtrList::iterator appIt = appenders.begin(); appIt != appenders.end(); ++appIt)
+		{
+			string const name = (*appIt)->getName();
+			if(previousAppenderProperties.exists(name))
+				previousAppenders[name] = *appIt;
+		}
+	}
+
+	configureAppenders(previous, previousAppenders);
+	configureLoggers();
+
+	// Loggers dropped from the configuration go back to inheriting.
+	vector<string> const previousLoggers = previous.getPropertySubset("logger.").propertyNames();
+	set<string> const currentLoggers(_loggerNames.begin(), _loggerNames.end());
+	for(vector<string>::const_iterator it = previousLoggers.begin(); it != previousLoggers.end(); ++it)
+	{
+		if(currentLoggers.count(*it) != 0)
+			continue;
+
+		Logger logger = getLogger(*it);
+		logger.setLogLevel(NOT_SET_LOG_LEVEL);
+		logger.setAppenders(SharedAppenderPtrList());
+	}
+
+	vector<string> const previousAdditivity = previous.getPropertySubset("additivity.").propertyNames();
+	Properties const currentAdditivity = _properties.getPropertySubset("additivity.");
+	for(vector<string>::const_iterator it = previousAdditivity.begin(); it != previousAdditivity.end(); ++it)
+	{
+		if(!currentAdditivity.exists(*it))
+			getLogger(*it).setAdditivity(true);
+	}
+
+	// Nothing refers to the replaced appenders any longer.
+	for(AppenderMap::iterator it = previousAppenders.begin(); it != previousAppenders.end(); ++it)
+	{
+		AppenderMap::iterator current = _appenders.find(it->first);
+		if(current == _appenders.end() || current->second != it->second)
+			it->second->close();
+	}
+
+	_appenders.clear();
+}
+
+
+Logger PropertyConfigurator::getLogger(const string& name)
+{
+	return _hierarchy.getInstance(name);
 }
 
 
@@ -222,3 +327,79 @@ void BasicConfigurator::doConfigure(Hierarchy& h, bool logToStdErr)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// ConfigureAndWatchThread
+///////////////////////////////////////////////////////////////////////////////
+
+ConfigureAndWatchThread::ConfigureAndWatchThread(const string& propertyFile, unsigned int millis, Hierarchy& h)
+	: _propertyFile(propertyFile)
+	, _millis(millis)
+	, _hierarchy(h)
+	, _lastModTime(0)
+	, _lastFileSize(-1)
+{
+	updateLastModInfo();
+
+	PropertyConfigurator configurator(_propertyFile, _hierarchy);
+	configurator.configure();
+	_properties = configurator.getProperties();
+
+	start();
+}
+
+
+ConfigureAndWatchThread::~ConfigureAndWatchThread()
+{
+	_stopEvent.signal();
+	join();
+}
+
+
+void ConfigureAndWatchThread::run()
+{
+	while(!_stopEvent.timedWait(_millis))
+	{
+		if(!checkForFileModification())
+			continue;
+
+		LogLog::getLogLog()->debug("ConfigureAndWatchThread: reloading " + _propertyFile);
+		updateLastModInfo();
+
+		PropertyConfigurator configurator(_propertyFile, _hierarchy);
+		configurator.reconfigure(_properties);
+		_properties = configurator.getProperties();
+	}
+}
+
+
+bool ConfigureAndWatchThread::checkForFileModification()
+{
+#ifdef _MSC_VER
+	struct _stat64 fileStatus;
+	if(_stat64(_propertyFile.c_str(), &fileStatus) != 0)
+		return false;
+#else
+	struct stat fileStatus;
+	if(stat(_propertyFile.c_str(), &fileStatus) != 0)
+		return false;
+#endif
+
+	return fileStatus.st_mtime != _lastModTime || fileStatus.st_size != _lastFileSize;
+}
+
+
+void ConfigureAndWatchThread::updateLastModInfo()
+{
+#ifdef _MSC_VER
+	struct _stat64 fileStatus;
+	if(_stat64(_propertyFile.c_str(), &fileStatus) != 0)
+		return;
+#else
+	struct stat fileStatus;
+	if(stat(_propertyFile.c_str(), &fileStatus) != 0)
+		return;
+#endif
+
+	_lastModTime = fileStatus.st_mtime;
+	_lastFileSize = fileStatus.st_size;
+}
@@ -7,19 +7,286 @@
 #include "log4cplus/stringhelper.h"
 #include "log4cplus/property.h"
 #include "log4cplus/loggingevent.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/atomic.h"
 
 #include <ostream>
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef _MSC_VER
+#include <unistd.h>
+#include <poll.h>
+#include <errno.h>
+#endif
 
 using namespace log4cplus;
 
 
-ConsoleAppender::ConsoleAppender(bool immediateFlush_) : _immediateFlush(immediateFlush_) {}
+#ifndef _MSC_VER
+
+namespace log4cplus
+{
+	/**
+	* The buffer of one descriptor, shared by the ConsoleAppenders in
+	* DirectWrite mode writing to it. A thread writes out what is buffered
+	* every FlushInterval.
+	*/
+	class ConsoleWriter : private Thread
+	{
+	public:
+		static ConsoleWriter* acquire(int fd, std::size_t bufferSize, unsigned long flushMillis);
+		static void release(ConsoleWriter* writer);
+
+		//! Writes out the buffers of all descriptors, registered with atexit().
+		static void flushAll();
+
+		void write(const char* data, std::size_t length, bool flushNow);
+		void flush();
+
+	private:
+		explicit ConsoleWriter(int fd);
+		virtual ~ConsoleWriter();
+
+		virtual void run();
+
+		//! Writes out the buffer; called with _bufferMutex held. Waits
+		//! for a full pipe if <code>wait</code> is set.
+		void writeOut(bool wait);
+
+		int _fd;
+		int _users;
+		std::size_t _bufferSize;
+		unsigned long _flushMillis;
+
+		Mutex _bufferMutex;
+		std::string _buffer;
+		std::size_t _writtenOut;	// bytes at the start of _buffer already written
+		bool _isFailed;
+
+		ManualResetEvent _wakeup;
+		volatile AtomicInt _stopping;
+	};
+}
+
+
+// Descriptors 1 and 2.
+static ConsoleWriter* s_writers[3];
+
+
+static Mutex& getWritersMutex()
+{
+	static Mutex writersMutex("ConsoleWriter::s_writers");
+	return writersMutex;
+}
+
+
+ConsoleWriter::ConsoleWriter(int fd)
+	: _fd(fd)
+	, _users(0)
+	, _bufferSize(0)
+	, _flushMillis(0)
+	, _bufferMutex("ConsoleWriter::_bufferMutex")
+	, _writtenOut(0)
+	, _isFailed(false)
+	, _stopping(0)
+{
+}
+
+
+ConsoleWriter::~ConsoleWriter()
+{
+}
+
+
+ConsoleWriter* ConsoleWriter::acquire(int fd, std::size_t bufferSize, unsigned long flushMillis)
+{
+	MutexLock lock(&getWritersMutex());
+
+	static bool isAtExitRegistered = false;
+	if(!isAtExitRegistered)
+	{
+		atexit(flushAll);
+		isAtExitRegistered = true;
+	}
+
+	ConsoleWriter* writer = s_writers[fd];
+	if(!writer)
+	{
+		writer = new ConsoleWriter(fd);
+		writer->_bufferSize = bufferSize;
+		writer->_flushMillis = flushMillis > 0 ? flushMillis : 1;
+
+		// Without the thread nothing would write out a partial buffer.
+		if(!writer->start())
+			writer->_bufferSize = 0;
+
+		s_writers[fd] = writer;
+	}
+	else
+	{
+		// The appenders sharing the descriptor get the strictest settings.
+		MutexLock bufferLock(&writer->_bufferMutex);
+		if(bufferSize < writer->_bufferSize)
+			writer->_bufferSize = bufferSize;
+		if(flushMillis > 0 && flushMillis < writer->_flushMillis)
+			writer->_flushMillis = flushMillis;
+	}
+
+	++writer->_users;
+	return writer;
+}
+
+
+void ConsoleWriter::release(ConsoleWriter* writer)
+{
+	MutexLock lock(&getWritersMutex());
+
+	if(--writer->_users > 0)
+		return;
+
+	s_writers[writer->_fd] = NULL;
+	if(writer->isStarted())
+	{
+		// The thread writes out the buffer before it returns.
+		atomicExchange(&writer->_stopping, 1);
+		writer->_wakeup.signal();
+		writer->join();
+	}
+	else
+		writer->flush();
+
+	delete writer;
+}
+
+
+void ConsoleWriter::flushAll()
+{
+	MutexLock lock(&getWritersMutex());
+
+	for(int fd = 1; fd <= 2; ++fd)
+	{
+		if(s_writers[fd])
+			s_writers[fd]->flush();
+	}
+}
+
+
+void ConsoleWriter::write(const char* data, std::size_t length, bool flushNow)
+{
+	MutexLock lock(&_bufferMutex);
+
+	_buffer.append(data, length);
+
+	std::size_t const pending = _buffer.size() - _writtenOut;
+	if(flushNow || pending >= _bufferSize)
+	{
+		// A full pipe only holds up logging once the backlog is large.
+		writeOut(pending >= 4 * _bufferSize && _bufferSize > 0);
+	}
+}
+
+
+void ConsoleWriter::flush()
+{
+	MutexLock lock(&_bufferMutex);
+
+	writeOut(true);
+}
+
+
+void ConsoleWriter::writeOut(bool wait)
+{
+	while(_writtenOut < _buffer.size())
+	{
+		ssize_t const written = ::write(_fd, _buffer.data() + _writtenOut, _buffer.size() - _writtenOut);
+		if(written > 0)
+		{
+			_writtenOut += written;
+			continue;
+		}
+
+		if(written < 0 && errno == EINTR)
+			continue;
+
+		if(written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			// The events stay buffered until the pipe drains.
+			if(!wait)
+				return;
+
+			struct pollfd pfd;
+			pfd.fd = _fd;
+			pfd.events = POLLOUT;
+			pfd.revents = 0;
+			if(poll(&pfd, 1, 1000) >= 0 || errno == EINTR)
+				continue;
+		}
+
+		// Nowhere to keep writing, e.g. the descriptor was closed.
+		if(!_isFailed)
+		{
+			LogLog::getLogLog()->error("ConsoleAppender- Cannot write to descriptor "
+				+ convertIntegerToString(_fd) + ": " + strerror(errno));
+			_isFailed = true;
+		}
+		break;
+	}
+
+	_buffer.clear();
+	_writtenOut = 0;
+}
+
+
+void ConsoleWriter::run()
+{
+	for(;;)
+	{
+		_wakeup.timedWait(_flushMillis);
+		bool const stopping = _stopping != 0;
+
+		{
+			MutexLock lock(&_bufferMutex);
+			writeOut(stopping);
+		}
+
+		if(stopping)
+			break;
+	}
+}
+
+#endif
+
+
+ConsoleAppender::ConsoleAppender(bool immediateFlush_)
+	: _immediateFlush(immediateFlush_), _logToStdErr(false), _writer(NULL)
+{
+}
+
+
+ConsoleAppender::ConsoleAppender(bool logToStdErr_, bool immediateFlush_)
+	: _immediateFlush(immediateFlush_), _logToStdErr(logToStdErr_), _writer(NULL)
+{
+}
 
 
 ConsoleAppender::ConsoleAppender(const Properties & properties)
-	: Appender(properties), _immediateFlush(false)
+	: Appender(properties), _immediateFlush(false), _logToStdErr(false), _writer(NULL)
 {
 	properties.getBool (_immediateFlush, "ImmediateFlush");
+	properties.getBool (_logToStdErr, "logToStdErr");
+
+	bool directWrite = false;
+	properties.getBool (directWrite, "DirectWrite");
+	if(directWrite)
+	{
+		int bufferSize = 65536;
+		int flushInterval = 100;
+		properties.getInt (bufferSize, "BufferSize");
+		properties.getInt (flushInterval, "FlushInterval");
+		setDirectWrite(bufferSize > 0 ? bufferSize : 0, flushInterval > 0 ? flushInterval : 1);
+	}
 }
 
 
@@ -29,18 +296,70 @@ ConsoleAppender::~ConsoleAppender()
 }
 
 
+void ConsoleAppender::setDirectWrite(std::size_t bufferSize, unsigned long flushMillis)
+{
+	MutexLock lock(&_mutex);
+
+#ifdef _MSC_VER
+	(void) bufferSize;
+	(void) flushMillis;
+	LogLog::getLogLog()->error("ConsoleAppender- DirectWrite is not supported on this platform");
+#else
+	if(_writer)
+		ConsoleWriter::release(_writer);
+	_writer = ConsoleWriter::acquire(_logToStdErr ? 2 : 1, bufferSize, flushMillis);
+#endif
+}
+
+
 void ConsoleAppender::close()
 {
+	MutexLock lock(&_mutex);
+
+#ifndef _MSC_VER
+	if(_writer)
+	{
+		ConsoleWriter::release(_writer);
+		_writer = NULL;
+	}
+#endif
+
 	_isClosed = true;
 }
 
 
-void ConsoleAppender::append(const InternalLoggingEvent& loggingEvent)
+void ConsoleAppender::flush()
 {
-	_layout->formatAndAppend(std::cout, loggingEvent);
-	if(_immediateFlush) 
+	MutexLock lock(&_mutex);
+
+#ifndef _MSC_VER
+	if(_writer)
 	{
-		std::cout.flush();
+		_writer->flush();
+		return;
 	}
+#endif
+
+	(_logToStdErr ? std::cerr : std::cout).flush();
 }
 
+
+void ConsoleAppender::append(const InternalLoggingEvent& loggingEvent)
+{
+	std::string const& text = formatEvent(loggingEvent);
+
+#ifndef _MSC_VER
+	if(_writer)
+	{
+		_writer->write(text.data(), text.size(), _immediateFlush);
+		return;
+	}
+#endif
+
+	std::ostream& output = _logToStdErr ? std::cerr : std::cout;
+	output.write(text.data(), text.size());
+	if(_immediateFlush)
+	{
+		output.flush();
+	}
+}
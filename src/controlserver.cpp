@@ -0,0 +1,380 @@
+// Module:  Log4CPLUS
+// File:    controlserver.cpp
+
+#include "log4cplus/controlserver.h"
+#include "log4cplus/hierarchy.h"
+#include "log4cplus/appender.h"
+#include "log4cplus/loglog.h"
+#include "log4cplus/mutex.h"
+#include "log4cplus/stringhelper.h"
+
+#include <set>
+#include <sstream>
+#include <iterator>
+
+#ifndef _MSC_VER
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+//! Connections that stay silent longer than this are dropped.
+static int const CLIENT_TIMEOUT_MILLIS = 5000;
+//! Longest accepted command line.
+static size_t const MAX_COMMAND_LENGTH = 1024;
+
+
+ControlServer::ControlServer(const string& socketPath, Hierarchy& h)
+	: _socketPath(socketPath)
+	, _hierarchy(h)
+	, _listenFd(-1)
+{
+	_wakeupPipe[0] = _wakeupPipe[1] = -1;
+
+#ifdef _MSC_VER
+	LogLog::getLogLog()->error("ControlServer- Unix domain sockets are not supported on this platform");
+#else
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if(_socketPath.empty() || _socketPath.size() >= sizeof(addr.sun_path))
+	{
+		LogLog::getLogLog()->error("ControlServer- Invalid socket path: " + _socketPath);
+		return;
+	}
+	strcpy(addr.sun_path, _socketPath.c_str());
+
+	if(pipe(_wakeupPipe) != 0)
+	{
+		LogLog::getLogLog()->error("ControlServer- pipe() failed");
+		_wakeupPipe[0] = _wakeupPipe[1] = -1;
+		return;
+	}
+
+	int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		LogLog::getLogLog()->error("ControlServer- socket() failed");
+		return;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+	// A stale socket of a previous run would make bind() fail.
+	unlink(_socketPath.c_str());
+	if(bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, 4) != 0)
+	{
+		LogLog::getLogLog()->error("ControlServer- Cannot listen on " + _socketPath + ": " + strerror(errno));
+		close(fd);
+		return;
+	}
+
+	_listenFd = fd;
+	if(!start())
+	{
+		close(_listenFd);
+		_listenFd = -1;
+		unlink(_socketPath.c_str());
+	}
+#endif
+}
+
+
+ControlServer::~ControlServer()
+{
+#ifndef _MSC_VER
+	if(isStarted())
+	{
+		char const c = 0;
+		ssize_t ret = write(_wakeupPipe[1], &c, 1);
+		(void) ret;
+		join();
+	}
+
+	if(_listenFd >= 0)
+	{
+		close(_listenFd);
+		unlink(_socketPath.c_str());
+	}
+
+	if(_wakeupPipe[0] >= 0)
+	{
+		close(_wakeupPipe[0]);
+		close(_wakeupPipe[1]);
+	}
+#endif
+}
+
+
+void ControlServer::run()
+{
+#ifndef _MSC_VER
+	for(;;)
+	{
+		struct pollfd fds[2];
+		fds[0].fd = _listenFd;
+		fds[0].events = POLLIN;
+		fds[1].fd = _wakeupPipe[0];
+		fds[1].events = POLLIN;
+
+		int const ret = poll(fds, 2, millisToNextRevert());
+		if(ret < 0 && errno != EINTR)
+		{
+			LogLog::getLogLog()->error("ControlServer- poll() failed");
+			return;
+		}
+
+		revertExpiredLevels();
+
+		if(ret <= 0)
+			continue;
+
+		if(fds[1].revents != 0)
+			return;
+
+		if(fds[0].revents & POLLIN)
+		{
+			int const clientFd = accept(_listenFd, 0, 0);
+			if(clientFd >= 0)
+			{
+				serveClient(clientFd);
+				close(clientFd);
+			}
+		}
+	}
+#endif
+}
+
+
+void ControlServer::serveClient(int fd)
+{
+#ifndef _MSC_VER
+	string pending;
+	char buf[256];
+
+	for(;;)
+	{
+		string::size_type eol;
+		while((eol = pending.find('\n')) != string::npos)
+		{
+			string line = pending.substr(0, eol);
+			pending.erase(0, eol + 1);
+			if(!line.empty() && line[line.size() - 1] == '\r')
+				line.erase(line.size() - 1);
+
+			string const reply = execute(line);
+			if(send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) < 0)
+				return;
+		}
+
+		if(pending.size() > MAX_COMMAND_LENGTH)
+			return;
+
+		struct pollfd pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if(poll(&pfd, 1, CLIENT_TIMEOUT_MILLIS) <= 0)
+			return;
+
+		ssize_t const n = recv(fd, buf, sizeof(buf), 0);
+		if(n <= 0)
+		{
+			// A last command without the line feed.
+			if(n == 0 && !pending.empty())
+			{
+				string const reply = execute(pending);
+				send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+			}
+			return;
+		}
+		pending.append(buf, n);
+	}
+#else
+	(void) fd;
+#endif
+}
+
+
+string ControlServer::execute(const string& command)
+{
+	vector<string> args;
+	tokenize(command, ' ', back_insert_iterator<vector<string> >(args), true);
+
+	if(args.empty())
+		return "ERROR empty command\n";
+	else if(args[0] == "set-level")
+		return setLevel(args);
+	else if(args[0] == "get-levels" && args.size() == 1)
+		return getLevels();
+	else if(args[0] == "stats" && args.size() == 1)
+		return stats();
+	else if(args[0] == "flush" && args.size() == 1)
+		return flush();
+
+	return "ERROR unknown command: " + command + "\n";
+}
+
+
+Logger ControlServer::getLogger(const string& name)
+{
+	if(name == "root")
+		return _hierarchy.getRoot();
+	return _hierarchy.getInstance(name);
+}
+
+
+string ControlServer::setLevel(const vector<string>& args)
+{
+	if(args.size() != 3 && args.size() != 4)
+		return "ERROR usage: set-level <logger> <LEVEL> [seconds]\n";
+
+	string const levelString = toUpper(args[2]);
+	LogLevel level = NOT_SET_LOG_LEVEL;
+	if(levelString != "INHERITED" && levelString != "NOTSET")
+	{
+		level = getLogLevelManager().fromString(levelString);
+		if(level == NOT_SET_LOG_LEVEL)
+			return "ERROR unknown LogLevel: " + args[2] + "\n";
+	}
+
+	long seconds = 0;
+	if(args.size() == 4)
+	{
+		istringstream iss(args[3]);
+		if(!(iss >> seconds) || seconds <= 0)
+			return "ERROR invalid number of seconds: " + args[3] + "\n";
+	}
+
+	// The root logger cannot be unset.
+	if(args[1] == "root" && level == NOT_SET_LOG_LEVEL)
+		return "ERROR the root logger needs a LogLevel\n";
+
+	Logger logger = getLogger(args[1]);
+
+	// A pending revert keeps the LogLevel from before the first change.
+	vector<PendingRevert>::iterator it = _reverts.begin();
+	while(it != _reverts.end() && it->logger != args[1])
+		++it;
+
+	if(seconds > 0)
+	{
+		if(it == _reverts.end())
+		{
+			PendingRevert revert;
+			revert.logger = args[1];
+			revert.level = logger.getLogLevel();
+			_reverts.push_back(revert);
+			it = _reverts.end() - 1;
+		}
+		it->deadline = TimeHelper::gettimeofday() + TimeHelper(seconds);
+	}
+	else if(it != _reverts.end())
+	{
+		_reverts.erase(it);
+	}
+
+	logger.setLogLevel(level);
+	LogLog::getLogLog()->debug("ControlServer: set-level " + args[1] + " " + levelString);
+
+	return "OK\n";
+}
+
+
+string ControlServer::getLevels()
+{
+	LoggerList loggers = _hierarchy.getCurrentLoggers();
+
+	LogLevelManager& llm = getLogLevelManager();
+	Logger root = _hierarchy.getRoot();
+
+	ostringstream reply;
+	reply << "root " << llm.toString(root.getLogLevel()) << " " << llm.toString(root.getLogLevel()) << "\n";
+
+	for(LoggerList::iterator it = loggers.begin(); it != loggers.end(); ++it)
+	{
+		reply << it->getName() << " " << llm.toString(it->getLogLevel())
+			<< " " << llm.toString(it->getChainedLogLevel()) << "\n";
+	}
+
+	reply << "OK\n";
+	return reply.str();
+}
+
+
+string ControlServer::stats()
+{
+	ostringstream reply;
+	Mutex::dumpStats(reply);
+	reply << "OK\n";
+	return reply.str();
+}
+
+
+string ControlServer::flush()
+{
+	LoggerList loggers = _hierarchy.getCurrentLoggers();
+	loggers.push_back(_hierarchy.getRoot());
+
+	// Appenders are often shared between loggers; flush each once.
+	set<Appender*> flushed;
+	for(LoggerList::iterator it = loggers.begin(); it != loggers.end(); ++it)
+	{
+		SharedAppenderPtrList appenders = it->getAllAppenders();
+		for(SharedAppenderPtrList::iterator appIt = appenders.begin(); appIt != appenders.end(); ++appIt)
+		{
+			if(flushed.insert(appIt->get()).second)
+				(*appIt)->flush();
+		}
+	}
+
+	return "OK\n";
+}
+
+
+void ControlServer::revertExpiredLevels()
+{
+	TimeHelper const now = TimeHelper::gettimeofday();
+
+	vector<PendingRevert>::iterator it = _reverts.begin();
+	while(it != _reverts.end())
+	{
+		if(now < it->deadline)
+		{
+			++it;
+			continue;
+		}
+
+		getLogger(it->logger).setLogLevel(it->level);
+		LogLog::getLogLog()->debug("ControlServer: reverted LogLevel of " + it->logger);
+		it = _reverts.erase(it);
+	}
+}
+
+
+int ControlServer::millisToNextRevert() const
+{
+	if(_reverts.empty())
+		return -1;
+
+	TimeHelper next = _reverts[0].deadline;
+	for(vector<PendingRevert>::size_type i = 1; i < _reverts.size(); ++i)
+	{
+		if(_reverts[i].deadline < next)
+			next = _reverts[i].deadline;
+	}
+
+	TimeHelper const now = TimeHelper::gettimeofday();
+	if(next <= now)
+		return 0;
+
+	TimeHelper const diff = next - now;
+	return static_cast<int>(diff.sec() * 1000 + diff.usec() / 1000) + 1;
+}
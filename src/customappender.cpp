@@ -6,15 +6,71 @@
 #include "log4cplus/layout.h"
 #include "log4cplus/loglog.h"
 #include "log4cplus/stringhelper.h"
+#include "log4cplus/property.h"
 #include "log4cplus/loggingevent.h"
 
-#include <strstream>
+#include <map>
 
 
 using namespace std;
 using namespace log4cplus;
 
 
+namespace
+{
+	struct CallBackRegistration
+	{
+		pCustomEventCallBack eventCallBack;
+		void* eventUserData;
+		pCustomBatchCallBack batchCallBack;
+		void* batchUserData;
+
+		CallBackRegistration()
+			: eventCallBack(NULL), eventUserData(NULL), batchCallBack(NULL), batchUserData(NULL)
+		{
+		}
+	};
+
+	typedef map<string, CallBackRegistration> CallBackRegistry;
+}
+
+
+// Bumped by every registration; appenders compare it with the one they
+// last read the registry at.
+static volatile AtomicInt s_registryGeneration = 1;
+
+
+static CallBackRegistry& getRegistry()
+{
+	static CallBackRegistry registry;
+	return registry;
+}
+
+
+static Mutex& getRegistryMutex()
+{
+	static Mutex registryMutex("CustomAppender::registry");
+	return registryMutex;
+}
+
+
+static CallBackRegistration findRegistration(const string& appenderName)
+{
+	MutexLock lock(&getRegistryMutex());
+
+	CallBackRegistry::const_iterator const it = getRegistry().find(appenderName);
+	return it != getRegistry().end() ? it->second : CallBackRegistration();
+}
+
+
+//! The layout output without the NULs SimpleLayout ends it with.
+static size_t textLength(const string& text)
+{
+	string::size_type const end = text.find_last_not_of('\0');
+	return end == string::npos ? 0 : end + 1;
+}
+
+
 pCustomFuncCallBack CustomAppender:: _pCustomFunc = NULL;
 
 
@@ -24,13 +80,64 @@ void CustomAppender::setCustomFunc(pCustomFuncCallBack pCustomFunc)
 }
 
 
+void CustomAppender::setEventCallBack(const string& appenderName, pCustomEventCallBack callBack, void* userData)
+{
+	MutexLock lock(&getRegistryMutex());
+
+	CallBackRegistration& registration = getRegistry()[appenderName];
+	registration.eventCallBack = callBack;
+	registration.eventUserData = userData;
+	atomicIncrement(&s_registryGeneration);
+}
+
+
+void CustomAppender::setBatchCallBack(const string& appenderName, pCustomBatchCallBack callBack, void* userData)
+{
+	MutexLock lock(&getRegistryMutex());
+
+	CallBackRegistration& registration = getRegistry()[appenderName];
+	registration.batchCallBack = callBack;
+	registration.batchUserData = userData;
+	atomicIncrement(&s_registryGeneration);
+}
+
+
 CustomAppender::CustomAppender()
+	: _queueMutex("CustomAppender::_queueMutex")
+	, _drainMutex("CustomAppender::_drainMutex")
+{
+	init(Properties());
+}
+
+
+CustomAppender::CustomAppender(const Properties& properties)
+	: Appender(properties)
+	, _queueMutex("CustomAppender::_queueMutex")
+	, _drainMutex("CustomAppender::_drainMutex")
 {
+	init(properties);
 }
 
 
-CustomAppender::CustomAppender(const Properties& properties) : Appender(properties)
+void CustomAppender::init(const Properties& properties)
 {
+	int batchSize = 1024;
+	int flushInterval = 100;
+	int queueLimit = 100000;
+	properties.getInt(batchSize, "BatchSize");
+	properties.getInt(flushInterval, "FlushInterval");
+	properties.getInt(queueLimit, "QueueLimit");
+
+	_batchSize = batchSize > 0 ? batchSize : 1;
+	_flushMillis = flushInterval > 0 ? flushInterval : 1;
+	_queueLimit = queueLimit > 0 ? queueLimit : 1;
+
+	_registryGeneration = 0;
+	_eventCallBack = NULL;
+	_eventUserData = NULL;
+	_hasBatchCallBack = false;
+	_stopping = 0;
+	_dropped = 0;
 }
 
 
@@ -42,22 +149,170 @@ CustomAppender::~CustomAppender()
 
 void CustomAppender::close()
 {
+	MutexLock lock(&_mutex);
+
+	if(isStarted())
+	{
+		// The drain thread delivers what is queued before it returns.
+		atomicExchange(&_stopping, 1);
+		_wakeup.signal();
+		join();
+	}
+
 	_isClosed = true;
 }
 
 
+void CustomAppender::flush()
+{
+	drainQueue();
+}
+
+
+void CustomAppender::setName(const string& name)
+{
+	Appender::setName(name);
+	_registryGeneration = 0;
+}
+
+
+AtomicInt64 CustomAppender::getDroppedCount() const
+{
+	return atomicLoad64(&_dropped);
+}
+
+
+// Called with _mutex held.
+void CustomAppender::updateCallBacks()
+{
+	AtomicInt const generation = s_registryGeneration;
+	if(generation == _registryGeneration)
+		return;
+
+	CallBackRegistration const registration = findRegistration(_name);
+	_eventCallBack = registration.eventCallBack;
+	_eventUserData = registration.eventUserData;
+	_hasBatchCallBack = registration.batchCallBack != NULL;
+	_registryGeneration = generation;
+}
+
+
 // This method does not need to be locked since it is called by
 // doAppend() which performs the locking
 void CustomAppender::append(const InternalLoggingEvent& loggingEvent)
 {
-	if (NULL == _pCustomFunc)
+	updateCallBacks();
+	if(!_hasBatchCallBack && !_eventCallBack && !_pCustomFunc)
+		return;
+
+	string const& text = formatEvent(loggingEvent);
+	string const& logger = loggingEvent.getLoggerName();
+
+	if(_hasBatchCallBack && (isStarted() || start()))
+	{
+		size_t queued;
+		{
+			MutexLock lock(&_queueMutex);
+			if(_queue.events.size() >= _queueLimit)
+			{
+				atomicAdd64(&_dropped, 1);
+				return;
+			}
+
+			QueuedEvent event;
+			event.logLevel = loggingEvent.getLogLevel();
+			event.loggerOffset = _queue.data.size();
+			event.loggerLength = logger.size();
+			event.textOffset = event.loggerOffset + logger.size();
+			event.length = textLength(text);
+			_queue.data.append(logger);
+			_queue.data.append(text, 0, event.length);
+			_queue.events.push_back(event);
+			queued = _queue.events.size();
+		}
+
+		// Wakes the drain thread once per batch rather than per event.
+		if(queued == _batchSize)
+			_wakeup.signal();
+		return;
+	}
+
+	if(_eventCallBack)
+	{
+		CustomLogSpan span;
+		span.logLevel = loggingEvent.getLogLevel();
+		span.logger = logger.data();
+		span.loggerLength = logger.size();
+		span.text = text.data();
+		span.length = textLength(text);
+		_eventCallBack(_eventUserData, &span);
 		return;
+	}
 
-	ostrstream output;
-	_layout->formatAndAppend(output, loggingEvent);
+	_pCustomFunc(text.c_str());
+}
 
-	string outstring = output.str();
 
-	_pCustomFunc(outstring.c_str());
+void CustomAppender::run()
+{
+	for(;;)
+	{
+		_wakeup.timedWait(_flushMillis);
+		bool const stopping = _stopping != 0;
+
+		drainQueue();
+
+		if(stopping)
+			break;
+	}
 }
 
+
+void CustomAppender::drainQueue()
+{
+	MutexLock lock(&_drainMutex);
+
+	{
+		MutexLock queueLock(&_queueMutex);
+		_wakeup.reset();
+		_draining.swap(_queue);
+	}
+
+	if(!_draining.events.empty())
+		deliver(_draining);
+	_draining.clear();
+}
+
+
+// Called with _drainMutex held.
+void CustomAppender::deliver(const Batch& batch)
+{
+	CallBackRegistration const registration = findRegistration(_name);
+
+	_spans.resize(batch.events.size());
+	for(size_t i = 0; i < batch.events.size(); ++i)
+	{
+		QueuedEvent const& event = batch.events[i];
+		CustomLogSpan& span = _spans[i];
+		span.logLevel = event.logLevel;
+		span.logger = batch.data.data() + event.loggerOffset;
+		span.loggerLength = event.loggerLength;
+		span.text = batch.data.data() + event.textOffset;
+		span.length = event.length;
+	}
+
+	if(registration.batchCallBack)
+	{
+		registration.batchCallBack(registration.batchUserData, &_spans[0], _spans.size());
+		return;
+	}
+
+	// The batch callback was removed while the events were queued.
+	for(size_t i = 0; i < _spans.size(); ++i)
+	{
+		if(registration.eventCallBack)
+			registration.eventCallBack(registration.eventUserData, &_spans[i]);
+		else if(_pCustomFunc)
+			_pCustomFunc(string(_spans[i].text, _spans[i].length).c_str());
+	}
+}
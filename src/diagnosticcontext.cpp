@@ -0,0 +1,179 @@
+// Module:  Log4CPLUS
+// File:    diagnosticcontext.cpp
+
+#include "log4cplus/diagnosticcontext.h"
+#include "log4cplus/loggingevent.h"
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+static string const s_empty;
+
+
+DiagnosticContext::DiagnosticContext()
+	: _mappedCount(0)
+	, _depth(0)
+{
+}
+
+
+DiagnosticContext::DiagnosticContext(const DiagnosticContext& rhs)
+	: _mappedCount(0)
+	, _depth(0)
+{
+	assign(rhs);
+}
+
+
+DiagnosticContext& DiagnosticContext::operator= (const DiagnosticContext& rhs)
+{
+	if(this != &rhs)
+		assign(rhs);
+	return *this;
+}
+
+
+// Copies the live entries only, into the slots already there.
+void DiagnosticContext::assign(const DiagnosticContext& rhs)
+{
+	if(_mapped.size() < rhs._mappedCount)
+		_mapped.resize(rhs._mappedCount);
+	for(size_t i = 0; i < rhs._mappedCount; ++i)
+	{
+		_mapped[i].key = rhs._mapped[i].key;
+		_mapped[i].value = rhs._mapped[i].value;
+	}
+	_mappedCount = rhs._mappedCount;
+
+	if(_nested.size() < rhs._depth)
+		_nested.resize(rhs._depth);
+	for(size_t i = 0; i < rhs._depth; ++i)
+		_nested[i] = rhs._nested[i];
+	_depth = rhs._depth;
+}
+
+
+void DiagnosticContext::swap(DiagnosticContext& other)
+{
+	_mapped.swap(other._mapped);
+	std::swap(_mappedCount, other._mappedCount);
+	_nested.swap(other._nested);
+	std::swap(_depth, other._depth);
+}
+
+
+void DiagnosticContext::put(const string& key, const string& value)
+{
+	for(size_t i = 0; i < _mappedCount; ++i)
+	{
+		if(_mapped[i].key == key)
+		{
+			_mapped[i].value = value;
+			return;
+		}
+	}
+
+	if(_mappedCount == _mapped.size())
+		_mapped.resize(_mappedCount + 1);
+
+	MappedEntry& entry = _mapped[_mappedCount++];
+	entry.key = key;
+	entry.value = value;
+}
+
+
+void DiagnosticContext::remove(const string& key)
+{
+	for(size_t i = 0; i < _mappedCount; ++i)
+	{
+		if(_mapped[i].key == key)
+		{
+			// Move the slot behind the live entries, swapping strings
+			// rather than copying them.
+			for(--_mappedCount; i < _mappedCount; ++i)
+			{
+				_mapped[i].key.swap(_mapped[i + 1].key);
+				_mapped[i].value.swap(_mapped[i + 1].value);
+			}
+			return;
+		}
+	}
+}
+
+
+const string* DiagnosticContext::get(const string& key) const
+{
+	for(size_t i = 0; i < _mappedCount; ++i)
+	{
+		if(_mapped[i].key == key)
+			return &_mapped[i].value;
+	}
+
+	return NULL;
+}
+
+
+void DiagnosticContext::push(const string& message)
+{
+	if(_depth == _nested.size())
+		_nested.resize(_depth + 1);
+
+	_nested[_depth++] = message;
+}
+
+
+void DiagnosticContext::pop()
+{
+	if(_depth > 0)
+		--_depth;
+}
+
+
+const string& DiagnosticContext::peek() const
+{
+	return _depth > 0 ? _nested[_depth - 1] : s_empty;
+}
+
+
+void DiagnosticContext::appendNested(string& result) const
+{
+	for(size_t i = 0; i < _depth; ++i)
+	{
+		if(i > 0)
+			result += ' ';
+		result += _nested[i];
+	}
+}
+
+
+DiagnosticContext& log4cplus::getDiagnosticContext()
+{
+	return getInternalLoggingEvent()->getDiagnosticContext();
+}
+
+
+MDCContextCreator::MDCContextCreator(const string& key, const string& value)
+	: _key(key)
+{
+	getDiagnosticContext().put(key, value);
+}
+
+
+MDCContextCreator::~MDCContextCreator()
+{
+	getDiagnosticContext().remove(_key);
+}
+
+
+NDCContextCreator::NDCContextCreator(const string& message)
+{
+	getDiagnosticContext().push(message);
+}
+
+
+NDCContextCreator::~NDCContextCreator()
+{
+	getDiagnosticContext().pop();
+}
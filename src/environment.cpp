@@ -13,6 +13,10 @@
 #ifdef _MSC_VER 
 #include <direct.h>
 #include <tchar.h>
+#else
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <dirent.h>
 #endif
 
 using namespace std;
@@ -472,3 +476,155 @@ void make_dirs(string const& file_path)
     }
 }
 
+
+static volatile int s_processId;
+
+
+int getProcessId()
+{
+	int pid = s_processId;
+	if(pid == 0)
+	{
+		refreshProcessId();
+		pid = s_processId;
+	}
+	return pid;
+}
+
+
+void refreshProcessId()
+{
+#ifdef _MSC_VER 
+	s_processId = static_cast<int>(GetCurrentProcessId());
+#else
+	s_processId = static_cast<int>(getpid());
+#endif
+}
+
+
+unsigned long getThreadId()
+{
+#ifdef _MSC_VER 
+	return GetCurrentThreadId();
+#else
+	return static_cast<unsigned long>(syscall(SYS_gettid));
+#endif
+}
+
+
+string getHostName()
+{
+#ifdef _MSC_VER 
+	char name[MAX_COMPUTERNAME_LENGTH + 1];
+	DWORD size = sizeof(name);
+	if(!GetComputerNameA(name, &size))
+		return string();
+	return string(name, size);
+#else
+	char name[256];
+	if(gethostname(name, sizeof(name)) != 0)
+		return string();
+	name[sizeof(name) - 1] = '\0';
+	return name;
+#endif
+}
+
+
+string getExecutableName()
+{
+	char path[4096];
+#ifdef _MSC_VER 
+	DWORD const length = GetModuleFileNameA(NULL, path, sizeof(path));
+	if(length == 0 || length == sizeof(path))
+		return string();
+#else
+	ssize_t const length = readlink("/proc/self/exe", path, sizeof(path));
+	if(length <= 0 || length == static_cast<ssize_t>(sizeof(path)))
+		return string();
+#endif
+
+	const char* name = path;
+	for(const char* p = path; p != path + length; ++p)
+	{
+		if(is_sep(*p))
+			name = p + 1;
+	}
+	return string(name, static_cast<const char*>(path) + length);
+}
+
+
+void splitDirectory(string& directory, string& baseName, string const& path)
+{
+#ifdef _MSC_VER
+	string::size_type const separator = path.find_last_of("/\\");
+#else
+	string::size_type const separator = path.find_last_of('/');
+#endif
+
+	if(separator == string::npos)
+	{
+		directory = ".";
+		baseName = path;
+	}
+	else
+	{
+		directory = separator == 0 ? path.substr(0, 1) : path.substr(0, separator);
+		baseName = path.substr(separator + 1);
+	}
+}
+
+
+#ifdef _MSC_VER
+
+DirectoryScan::DirectoryScan(const string& directory)
+{
+	_find = FindFirstFileA((directory + "\\*").c_str(), &_data);
+	_hasData = _find != INVALID_HANDLE_VALUE;
+}
+
+
+DirectoryScan::~DirectoryScan()
+{
+	if(_find != INVALID_HANDLE_VALUE)
+		FindClose(_find);
+}
+
+
+bool DirectoryScan::next(string& name)
+{
+	if(!_hasData)
+		return false;
+
+	name = _data.cFileName;
+	_hasData = FindNextFileA(_find, &_data) != 0;
+	return true;
+}
+
+#else	//__linux__
+
+DirectoryScan::DirectoryScan(const string& directory) : _dir(opendir(directory.c_str()))
+{
+}
+
+
+DirectoryScan::~DirectoryScan()
+{
+	if(_dir)
+		closedir(_dir);
+}
+
+
+bool DirectoryScan::next(string& name)
+{
+	if(!_dir)
+		return false;
+
+	struct dirent* const entry = readdir(_dir);
+	if(!entry)
+		return false;
+
+	name = entry->d_name;
+	return true;
+}
+
+#endif
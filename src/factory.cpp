@@ -10,6 +10,8 @@
 #include "log4cplus/fileappender.h"
 #include "log4cplus/nullappender.h"
 #include "log4cplus/customappender.h"
+#include "log4cplus/socketappender.h"
+#include "log4cplus/sharedmemoryappender.h"
 
 
 using namespace log4cplus;
@@ -55,16 +57,25 @@ void log4cplus::initializeFactoryRegistry()
     LOG4CPLUS_REG_APPENDER(reg, FileAppender);
     LOG4CPLUS_REG_APPENDER(reg, RollingFileAppender);
     LOG4CPLUS_REG_APPENDER(reg, DailyRollingFileAppender);
+    LOG4CPLUS_REG_APPENDER(reg, SizeAndTimeRollingFileAppender);
 	LOG4CPLUS_REG_APPENDER(reg, CustomAppender);
+	LOG4CPLUS_REG_APPENDER(reg, SocketAppender);
+	LOG4CPLUS_REG_APPENDER(reg, SharedMemoryAppender);
 
 
     LayoutFactoryRegistry& reg2 = getLayoutFactoryRegistry();
     LOG4CPLUS_REG_LAYOUT(reg2, SimpleLayout);
     LOG4CPLUS_REG_LAYOUT(reg2, PatternLayout);
+    LOG4CPLUS_REG_LAYOUT(reg2, JsonLayout);
 
     FilterFactoryRegistry& reg3 = getFilterFactoryRegistry();
     LOG4CPLUS_REG_FILTER(reg3, DenyAllFilter);
     LOG4CPLUS_REG_FILTER(reg3, LogLevelMatchFilter);
     LOG4CPLUS_REG_FILTER(reg3, LogLevelRangeFilter);
+    LOG4CPLUS_REG_FILTER(reg3, TokenBucketFilter);
+    LOG4CPLUS_REG_FILTER(reg3, SamplingFilter);
+    LOG4CPLUS_REG_FILTER(reg3, DuplicateSuppressionFilter);
+    LOG4CPLUS_REG_FILTER(reg3, StringMatchFilter);
+    LOG4CPLUS_REG_FILTER(reg3, RegexFilter);
 }
 
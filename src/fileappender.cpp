@@ -11,12 +11,25 @@
 #include "log4cplus/loggingevent.h"
 #include "log4cplus/factory.h"
 #include "log4cplus/environment.h"
+#include "log4cplus/thread.h"
+#include "log4cplus/tls.h"
+#include "log4cplus/retention.h"
 
 #include <algorithm>
 #include <sstream>
 #include <cstdio>
 #include <stdexcept>
 #include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef _MSC_VER
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 using namespace std;
@@ -71,24 +84,15 @@ static void rolloverFiles(const string& filename, unsigned int maxBackupIndex)
 	LogLog* loglog = LogLog::getLogLog();
 
 	// Delete the oldest file
-	ostringstream buffer;
-	buffer << filename << "." << maxBackupIndex;
-	long ret = removeFile(buffer.str());
-
-	ostringstream source_oss;
-	ostringstream target_oss;
+	string const prefix = filename + ".";
+	string target = prefix + convertIntegerToString(maxBackupIndex);
+	long ret = removeFile(target);
 
-	// Map {(maxBackupIndex - 1), ..., 2, 1} to {maxBackupIndex, ..., 3, 2}
+	// Map {(maxBackupIndex - 1), ..., 2, 1} to {maxBackupIndex, ..., 3, 2};
+	// each source is the target of the next step.
 	for(int i = maxBackupIndex - 1; i >= 1; --i)
 	{
-		source_oss.str("");
-		target_oss.str("");
-
-		source_oss << filename << "." << i;
-		target_oss << filename << "." <<(i+1);
-
-		string const source(source_oss.str());
-		string const target(target_oss.str());
+		string const source = prefix + convertIntegerToString(i);
 
 #ifdef _MSC_VER 
 		// Try to remove the target first. It seems it is not
@@ -98,14 +102,406 @@ static void rolloverFiles(const string& filename, unsigned int maxBackupIndex)
 
 		ret = renameFile(source, target);
 		loglog_renamingResult(loglog, source, target, ret);
+
+		target = source;
 	}
 } // end rolloverFiles()
 
 
+//! The highest N of the files named <code>prefix</code>.N, zero if none.
+static long findHighestIndex(const string& prefix)
+{
+	string directory;
+	string baseName;
+	splitDirectory(directory, baseName, prefix);
+
+	long highest = 0;
+	string name;
+	DirectoryScan scan(directory);
+	while(scan.next(name))
+	{
+		if(name.size() > baseName.size() + 1
+			&& name.compare(0, baseName.size(), baseName) == 0
+			&& name[baseName.size()] == '.'
+			&& name.find_first_not_of("0123456789", baseName.size() + 1) == string::npos)
+		{
+			highest = (std::max)(highest, std::atol(name.c_str() + baseName.size() + 1));
+		}
+	}
+
+	return highest;
+}
+
+
+//! The index after the highest one of the files named
+//! <code>prefix</code>.N. Only reads the directory if
+//! <code>prefix</code>.1 exists, so not at the start of a period.
+static int findNextIndex(const string& prefix)
+{
+	struct stat info;
+	if(stat((prefix + ".1").c_str(), &info) != 0)
+		return 1;
+
+	return static_cast<int>(findHighestIndex(prefix)) + 1;
+}
+
+
+//! Reads MaxFileSize, in bytes or with a KB or MB suffix.
+static long getMaxFileSize(const Properties& properties)
+{
+	long maxFileSize = DEFAULT_ROLLING_LOG_SIZE;
+	string tmp(toUpper(properties.getProperty("MaxFileSize")));
+
+	if(!tmp.empty())
+	{
+		maxFileSize = std::atoi(tmp.c_str());
+		if(maxFileSize != 0)
+		{
+			string::size_type const len = tmp.length();
+			if(len > 2 && tmp.compare(len - 2, 2, "MB") == 0)
+				maxFileSize *=(1024 * 1024); // convert to megabytes
+			else if(len > 2 && tmp.compare(len - 2, 2, "KB") == 0)
+				maxFileSize *= 1024; // convert to kilobytes
+		}
+	}
+
+	return maxFileSize;
+}
+
+
+namespace log4cplus
+{
+	//! The events a thread formatted for a FileAppender in WriteCombining
+	//! mode and not yet written.
+	struct ThreadBuffer
+	{
+		explicit ThreadBuffer(std::auto_ptr<Layout> layout_)
+			: mutex("FileAppender::ThreadBuffer"), layout(layout_), isIdle(false), isClosed(false)
+		{
+		}
+
+		// Taken by the thread for every event, by others only to commit.
+		Mutex mutex;
+		string data;
+		TimeHelper timestamp;		// of the first event in data
+		std::auto_ptr<Layout> layout;
+		StringByteSink sink;
+		bool isIdle;				// nothing appended since the last commit
+		bool isClosed;
+	};
+
+
+	//! Commits the thread buffers of an appender every ThreadFlushInterval.
+	class ThreadBufferFlusher : public Thread
+	{
+	public:
+		explicit ThreadBufferFlusher(FileAppender& appender) : _appender(appender), _stopping(0) {}
+
+		void stop()
+		{
+			atomicExchange(&_stopping, 1);
+			_wakeup.signal();
+			join();
+		}
+
+	protected:
+		virtual void run()
+		{
+			for(;;)
+			{
+				_wakeup.timedWait(_appender._threadFlushMillis);
+				bool const stopping = _stopping != 0;
+
+				_appender.commitThreadBuffers(true);
+
+				if(stopping)
+					break;
+			}
+		}
+
+	private:
+		FileAppender& _appender;
+		ManualResetEvent _wakeup;
+		volatile AtomicInt _stopping;
+	};
+}
+
+
+#ifdef _MSC_VER
+typedef HANDLE SyncHandle;
+static SyncHandle const INVALID_SYNC_HANDLE = INVALID_HANDLE_VALUE;
+#else	//__linux__
+typedef int SyncHandle;
+static SyncHandle const INVALID_SYNC_HANDLE = -1;
+#endif
+
+
+//! Opens a second handle of a log file to sync it through.
+static SyncHandle openSyncHandle(const string& filename)
+{
+#ifdef _MSC_VER
+	return CreateFileA(filename.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+#else	//__linux__
+	return ::open(filename.c_str(), O_WRONLY);
+#endif
+}
+
+
+static bool syncHandle(SyncHandle handle)
+{
+#ifdef _MSC_VER
+	return FlushFileBuffers(handle) != 0;
+#else	//__linux__
+	return fdatasync(handle) == 0;
+#endif
+}
+
+
+static void closeSyncHandle(SyncHandle handle)
+{
+#ifdef _MSC_VER
+	CloseHandle(handle);
+#else	//__linux__
+	::close(handle);
+#endif
+}
+
+
+namespace log4cplus
+{
+	/**
+	* Syncs the file of a FileAppender with a Durability policy. Each
+	* round syncs everything written before it started, so the events
+	* written during a sync share the next one (group commit).
+	*/
+	class DurabilitySyncer : public Thread
+	{
+	public:
+		explicit DurabilitySyncer(FileAppender& appender)
+			: _appender(appender)
+			, _handleMutex("DurabilitySyncer::_handleMutex")
+			, _handle(INVALID_SYNC_HANDLE)
+			, _isFailed(false)
+			, _waitersMutex("DurabilitySyncer::_waitersMutex")
+			, _synced(0)
+			, _stopping(0)
+		{
+		}
+
+		virtual ~DurabilitySyncer()
+		{
+			if(_handle != INVALID_SYNC_HANDLE)
+				closeSyncHandle(_handle);
+		}
+
+		void stop()
+		{
+			atomicExchange(&_stopping, 1);
+			_wakeup.signal();
+			join();
+		}
+
+		//! Starts a round as soon as the current one is done.
+		void request()
+		{
+			_wakeup.signal();
+		}
+
+		//! Blocks until the first <code>position</code> bytes are durable.
+		void waitFor(AtomicInt64 position)
+		{
+			ManualResetEvent done;
+			{
+				MutexLock lock(&_waitersMutex);
+				if(_synced >= position)
+					return;
+
+				Waiter const waiter = { position, &done };
+				_waiters.push_back(waiter);
+			}
+
+			request();
+			done.wait();
+
+			// setSynced() signals under the lock; done must outlive that.
+			MutexLock lock(&_waitersMutex);
+		}
+
+		/**
+		* Syncs in the calling thread, called with the appender's _mutex
+		* held and its stream flushed. With <code>isClosing</code> the
+		* handle is closed, as the file is about to be closed or renamed.
+		*/
+		void syncNow(AtomicInt64 position, bool isClosing)
+		{
+			{
+				MutexLock lock(&_handleMutex);
+				if(_handle == INVALID_SYNC_HANDLE)
+					_handle = openSyncHandle(_appender._filename);
+				sync();
+				if(isClosing && _handle != INVALID_SYNC_HANDLE)
+				{
+					closeSyncHandle(_handle);
+					_handle = INVALID_SYNC_HANDLE;
+				}
+			}
+
+			setSynced(position);
+		}
+
+	protected:
+		virtual void run()
+		{
+			for(;;)
+			{
+				_wakeup.timedWait(_appender._durabilityMillis);
+				bool const stopping = _stopping != 0;
+
+				syncRound();
+
+				if(stopping)
+					break;
+			}
+		}
+
+	private:
+		struct Waiter
+		{
+			AtomicInt64 position;
+			ManualResetEvent* done;
+		};
+
+		void syncRound()
+		{
+			// Requests from here on are either covered by this round or
+			// start the next one.
+			_wakeup.reset();
+
+			AtomicInt64 position;
+			{
+				MutexLock lock(&_appender._mutex);
+
+				position = atomicLoad64(&_appender._writtenBytes);
+				{
+					MutexLock waitersLock(&_waitersMutex);
+					if(position <= _synced)
+						return;
+				}
+
+				if(_appender._out.is_open())
+					_appender._out.flush();
+
+				// Opened under the appender lock, so it is the file the
+				// position refers to.
+				MutexLock handleLock(&_handleMutex);
+				if(_handle == INVALID_SYNC_HANDLE)
+					_handle = openSyncHandle(_appender._filename);
+			}
+
+			{
+				MutexLock lock(&_handleMutex);
+
+				// Otherwise syncNow() closed the file after position was read,
+				// and synced it up to there.
+				if(_handle != INVALID_SYNC_HANDLE)
+					sync();
+			}
+
+			setSynced(position);
+		}
+
+		// Called with _handleMutex held.
+		void sync()
+		{
+			bool const isSynced = _handle != INVALID_SYNC_HANDLE && syncHandle(_handle);
+			if(!isSynced && !_isFailed)
+			{
+				LogLog::getLogLog()->error("FileAppender- Cannot sync " + _appender._filename
+					+ ": " + strerror(errno));
+			}
+			_isFailed = !isSynced;
+		}
+
+		//! Wakes the waiters covered by <code>position</code>. Waiters are
+		//! also woken after a failed sync, which is reported by LogLog.
+		void setSynced(AtomicInt64 position)
+		{
+			MutexLock lock(&_waitersMutex);
+
+			if(position > _synced)
+				_synced = position;
+
+			size_t kept = 0;
+			for(size_t i = 0; i < _waiters.size(); ++i)
+			{
+				if(_waiters[i].position <= _synced)
+					_waiters[i].done->signal();
+				else
+					_waiters[kept++] = _waiters[i];
+			}
+			_waiters.resize(kept);
+		}
+
+		FileAppender& _appender;
+
+		Mutex _handleMutex;
+		SyncHandle _handle;
+		bool _isFailed;
+
+		Mutex _waitersMutex;
+		AtomicInt64 _synced;
+		vector<Waiter> _waiters;
+
+		ManualResetEvent _wakeup;
+		volatile AtomicInt _stopping;
+	};
+}
+
+
+namespace
+{
+	//! A thread's buffer for one appender, found by the serial number of
+	//! the appender; serial numbers are never reused, so entries of
+	//! destroyed appenders are never matched.
+	struct ThreadBufferSlot
+	{
+		AtomicInt serial;
+		ThreadBuffer* buffer;	// NULL if the layout cannot be cloned
+	};
+
+	typedef vector<ThreadBufferSlot> ThreadBufferSlots;
+}
+
+
+static volatile AtomicInt s_threadBufferSerial = 0;
+static TLSKeyType s_threadBufferKey;
+
+
+static void deleteThreadBufferSlots(void* slots)
+{
+	// The buffers belong to the appenders.
+	delete static_cast<ThreadBufferSlots*>(slots);
+}
+
+
+static Mutex& getThreadBufferKeyMutex()
+{
+	static Mutex keyMutex("FileAppender::s_threadBufferKey");
+	return keyMutex;
+}
+
+
 FileAppender::FileAppender(const string& filename, std::ios_base::openmode mode, bool immediateFlush, bool createDirs)
 	: _immediateFlush(immediateFlush), _isCreateDirs(createDirs)
 	, _reopenDelay(1), _ofstreamBufferSize(0)
 	, _ofstreamBuffer(0)
+	, _threadBufferSize(0), _threadFlushMillis(0), _threadBufferSerial(0)
+	, _threadBuffersMutex("FileAppender::_threadBuffersMutex")
+	, _isThreadBuffersClosed(false), _flusher(NULL)
+	, _durability(DURABILITY_NONE), _durabilityMillis(0), _durabilityBytes(0)
+	, _durabilityLevel(ERROR_LOG_LEVEL), _writtenBytes(0), _unrequestedBytes(0)
+	, _syncer(NULL), _retentionId(0)
 {
 	init(filename, mode);
 }
@@ -115,6 +511,12 @@ FileAppender::FileAppender(const Properties& props, std::ios_base::openmode mode
 	: Appender(props), _immediateFlush(true)
 	, _isCreateDirs(false), _reopenDelay(1)
 	, _ofstreamBufferSize(0), _ofstreamBuffer(0)
+	, _threadBufferSize(0), _threadFlushMillis(0), _threadBufferSerial(0)
+	, _threadBuffersMutex("FileAppender::_threadBuffersMutex")
+	, _isThreadBuffersClosed(false), _flusher(NULL)
+	, _durability(DURABILITY_NONE), _durabilityMillis(0), _durabilityBytes(0)
+	, _durabilityLevel(ERROR_LOG_LEVEL), _writtenBytes(0), _unrequestedBytes(0)
+	, _syncer(NULL), _retentionId(0)
 {
 	bool app =(mode &(std::ios_base::app | std::ios_base::ate)) != 0;
 	string const& fn = props.getProperty("File");
@@ -131,6 +533,64 @@ FileAppender::FileAppender(const Properties& props, std::ios_base::openmode mode
 	props.getULong(_ofstreamBufferSize, "BufferSize");
 
 	init(fn,(app ? std::ios::app : std::ios::trunc));
+
+	bool writeCombining = false;
+	props.getBool(writeCombining, "WriteCombining");
+	if(writeCombining)
+	{
+		int threadBufferSize = 65536;
+		int threadFlushInterval = 200;
+		props.getInt(threadBufferSize, "ThreadBufferSize");
+		props.getInt(threadFlushInterval, "ThreadFlushInterval");
+		setWriteCombining(threadBufferSize > 0 ? threadBufferSize : 0,
+			threadFlushInterval > 0 ? threadFlushInterval : 1);
+	}
+
+	string const durability(toUpper(props.getProperty("Durability", "NONE")));
+	if(durability != "NONE")
+	{
+		DurabilityPolicy policy = DURABILITY_NONE;
+		if(durability == "INTERVAL")
+			policy = DURABILITY_INTERVAL;
+		else if(durability == "BYTES")
+			policy = DURABILITY_BYTES;
+		else if(durability == "LEVEL")
+			policy = DURABILITY_LEVEL;
+		else
+			LogLog::getLogLog()->error("FileAppender- Durability not valid: " + props.getProperty("Durability"));
+
+		int interval = 1000;
+		unsigned long bytes = 1048576;
+		props.getInt(interval, "DurabilityInterval");
+		props.getULong(bytes, "DurabilityBytes");
+
+		LogLevel level = ERROR_LOG_LEVEL;
+		string const levelString = props.getProperty("DurabilityLevel");
+		if(!levelString.empty())
+			level = getLogLevelManager().fromString(levelString);
+
+		setDurability(policy, interval > 0 ? interval : 1, bytes, level);
+	}
+
+	long long maxTotalSize = 0;
+	int maxAgeDays = 0;
+	string const maxTotalSizeString(toUpper(props.getProperty("MaxTotalSize")));
+	if(!maxTotalSizeString.empty())
+	{
+		istringstream(maxTotalSizeString) >> maxTotalSize;
+
+		string::size_type const len = maxTotalSizeString.length();
+		if(len > 2 && maxTotalSizeString.compare(len - 2, 2, "GB") == 0)
+			maxTotalSize *= 1024 * 1024 * 1024;
+		else if(len > 2 && maxTotalSizeString.compare(len - 2, 2, "MB") == 0)
+			maxTotalSize *= 1024 * 1024;
+		else if(len > 2 && maxTotalSizeString.compare(len - 2, 2, "KB") == 0)
+			maxTotalSize *= 1024;
+	}
+	props.getInt(maxAgeDays, "MaxAgeDays");
+
+	if(maxTotalSize > 0 || maxAgeDays > 0)
+		setRetention(maxTotalSize > 0 ? maxTotalSize : 0, maxAgeDays > 0 ? maxAgeDays : 0);
 }
 
 
@@ -157,13 +617,99 @@ void FileAppender::init(const string& filename_, std::ios_base::openmode mode_)
 FileAppender::~FileAppender()
 {
 	destructorImpl();
+
+	delete _syncer;
+	for(vector<ThreadBuffer*>::iterator it = _threadBuffers.begin(); it != _threadBuffers.end(); ++it)
+		delete *it;
+}
+
+
+void FileAppender::setWriteCombining(size_t threadBufferSize, unsigned long flushMillis)
+{
+	{
+		MutexLock lock(&getThreadBufferKeyMutex());
+		static bool isKeyCreated = false;
+		if(!isKeyCreated)
+		{
+			s_threadBufferKey = TLSInit(deleteThreadBufferSlots);
+			isKeyCreated = true;
+		}
+	}
+
+	if(_flusher)
+		return;
+
+	_threadBufferSize = threadBufferSize;
+	_threadFlushMillis = flushMillis > 0 ? flushMillis : 1;
+	_threadBufferSerial = atomicIncrement(&s_threadBufferSerial);
+
+	_flusher = new ThreadBufferFlusher(*this);
+	if(!_flusher->start())
+	{
+		// Nothing would write out buffers that do not fill up.
+		delete _flusher;
+		_flusher = NULL;
+		return;
+	}
+
+	_isAppendUnlocked = true;
+}
+
+
+void FileAppender::setDurability(DurabilityPolicy policy, unsigned long intervalMillis, size_t bytes, LogLevel level)
+{
+	if(_syncer || policy == DURABILITY_NONE)
+		return;
+
+	_durabilityMillis = intervalMillis > 0 ? intervalMillis : 1;
+	_durabilityBytes = bytes > 0 ? bytes : 1;
+	_durabilityLevel = level;
+
+	_syncer = new DurabilitySyncer(*this);
+	if(!_syncer->start())
+	{
+		getErrorHandler()->error("Unable to start the durability thread for " + _filename);
+		delete _syncer;
+		_syncer = NULL;
+		return;
+	}
+
+	_durability = policy;
+
+	// Waiting for a sync must not hold up other threads writing.
+	if(policy == DURABILITY_LEVEL)
+		_isAppendUnlocked = true;
+}
+
+
+void FileAppender::setRetention(long long maxTotalSize, unsigned int maxAgeDays)
+{
+	if(_retentionId != 0)
+		RetentionManager::getInstance().removeFamily(_retentionId);
+	_retentionId = 0;
+
+	if(maxTotalSize > 0 || maxAgeDays > 0)
+		_retentionId = RetentionManager::getInstance().addFamily(_filename, maxTotalSize, maxAgeDays);
 }
 
 
 void FileAppender::close()
 {
+	closeThreadBuffers();
+
+	if(_retentionId != 0)
+	{
+		RetentionManager::getInstance().removeFamily(_retentionId);
+		_retentionId = 0;
+	}
+
+	// The last round syncs what the buffers held.
+	if(_syncer)
+		_syncer->stop();
+
 	MutexLock lock(&_mutex);
 
+	syncFile();
 	_out.close();
 	delete[] _ofstreamBuffer;
 	_ofstreamBuffer = 0;
@@ -171,9 +717,52 @@ void FileAppender::close()
 }
 
 
+void FileAppender::flush()
+{
+	commitThreadBuffers(false);
+
+	MutexLock lock(&_mutex);
+
+	if(_out.is_open())
+		_out.flush();
+}
+
+
 // This method does not need to be locked since it is called by
 // doAppend() which performs the locking
 void FileAppender::append(const InternalLoggingEvent& loggingEvent)
+{
+	string const& text = formatEvent(loggingEvent);
+	writeText(text.data(), text.size(), loggingEvent.getTimestamp());
+
+	// Under the appender lock, e.g. with filters other than LogLevel
+	// filters, the event is synced here rather than waited for.
+	if(_durability == DURABILITY_LEVEL && loggingEvent.getLogLevel() >= _durabilityLevel)
+	{
+		_out.flush();
+		_syncer->syncNow(atomicLoad64(&_writtenBytes), false);
+	}
+}
+
+
+void FileAppender::notifyRolled(const vector<string>& paths)
+{
+	if(_retentionId != 0)
+		RetentionManager::getInstance().rolled(_retentionId, paths);
+}
+
+
+void FileAppender::syncFile()
+{
+	if(!_syncer || !_out.is_open())
+		return;
+
+	_out.flush();
+	_syncer->syncNow(atomicLoad64(&_writtenBytes), true);
+}
+
+
+void FileAppender::writeText(const char* data, size_t length, const TimeHelper&)
 {
 	if(!_out.good())
 	{
@@ -184,16 +773,178 @@ void FileAppender::append(const InternalLoggingEvent& loggingEvent)
 		}
 		// Resets the errorhandler to make it 
 		// ready to handle a future append error.
+		getErrorHandler()->reset();
+	}
+
+	_out.write(data, length);
+
+	if(_immediateFlush)
+		_out.flush();
+
+	if(_syncer)
+	{
+		atomicStore64(&_writtenBytes, _writtenBytes + length);
+
+		_unrequestedBytes += length;
+		if(_durability == DURABILITY_BYTES && _unrequestedBytes >= _durabilityBytes)
+		{
+			_syncer->request();
+			_unrequestedBytes = 0;
+		}
+	}
+}
+
+
+void FileAppender::appendUnlocked(const InternalLoggingEvent& loggingEvent)
+{
+	bool const isDurable = _durability == DURABILITY_LEVEL && loggingEvent.getLogLevel() >= _durabilityLevel;
+
+	ThreadBuffer* const buffer = _flusher ? getThreadBuffer() : NULL;
+	if(buffer)
+	{
+		MutexLock lock(&buffer->mutex);
+		if(buffer->isClosed)
+			return;
+
+		if(buffer->data.empty())
+			buffer->timestamp = loggingEvent.getTimestamp();
+		buffer->isIdle = false;
+
+		// Another appender of the dispatch may have formatted the event.
+		bool isNew = true;
+		string* const shared = _layoutShareId != 0 ? loggingEvent.getSharedFormat(_layoutShareId, isNew) : NULL;
+		if(shared && !isNew)
+			buffer->data += *shared;
 		else
 		{
-			getErrorHandler()->reset();
+			buffer->sink.setTarget(shared ? shared : &buffer->data);
+			buffer->layout->format(buffer->sink, loggingEvent);
+			if(shared)
+				buffer->data += *shared;
 		}
+
+		if(buffer->data.size() >= _threadBufferSize || loggingEvent.getLogLevel() >= ERROR_LOG_LEVEL || isDurable)
+			commitThreadBuffer(*buffer);
 	}
+	else
+	{
+		MutexLock lock(&_mutex);
+		if(_isClosed)
+			return;
 
-	_layout->formatAndAppend(_out, loggingEvent);
+		string const& text = formatEvent(loggingEvent);
+		writeText(text.data(), text.size(), loggingEvent.getTimestamp());
+	}
 
-	if(_immediateFlush)
-		_out.flush();
+	// Outside the locks, so the events written meanwhile share the sync.
+	if(isDurable)
+		_syncer->waitFor(atomicLoad64(&_writtenBytes));
+}
+
+
+ThreadBuffer* FileAppender::getThreadBuffer()
+{
+	ThreadBufferSlots* slots = static_cast<ThreadBufferSlots*>(TLSGetValue(s_threadBufferKey));
+	if(!slots)
+	{
+		slots = new ThreadBufferSlots;
+		TLSSetValue(s_threadBufferKey, slots);
+	}
+
+	for(ThreadBufferSlots::const_iterator it = slots->begin(); it != slots->end(); ++it)
+	{
+		if(it->serial == _threadBufferSerial)
+			return it->buffer;
+	}
+
+	std::auto_ptr<Layout> layout;
+	{
+		MutexLock lock(&_mutex);
+		if(_layout.get())
+			layout = _layout->clone();
+	}
+
+	ThreadBufferSlot slot;
+	slot.serial = _threadBufferSerial;
+	slot.buffer = NULL;
+	if(layout.get())
+	{
+		MutexLock lock(&_threadBuffersMutex);
+		if(_isThreadBuffersClosed)
+			return NULL;
+
+		slot.buffer = new ThreadBuffer(layout);
+		_threadBuffers.push_back(slot.buffer);
+	}
+
+	slots->push_back(slot);
+	return slot.buffer;
+}
+
+
+// Called with buffer.mutex held.
+void FileAppender::commitThreadBuffer(ThreadBuffer& buffer)
+{
+	if(buffer.data.empty())
+		return;
+
+	{
+		MutexLock lock(&_mutex);
+		if(!_isClosed)
+			writeText(buffer.data.data(), buffer.data.size(), buffer.timestamp);
+	}
+
+	buffer.data.clear();
+}
+
+
+void FileAppender::commitThreadBuffers()
+{
+	commitThreadBuffers(false);
+}
+
+
+void FileAppender::commitThreadBuffers(bool isReleasingIdle)
+{
+	MutexLock lock(&_threadBuffersMutex);
+
+	for(vector<ThreadBuffer*>::iterator it = _threadBuffers.begin(); it != _threadBuffers.end(); ++it)
+	{
+		ThreadBuffer& buffer = **it;
+		MutexLock bufferLock(&buffer.mutex);
+		commitThreadBuffer(buffer);
+
+		// Gives back the memory of threads that stopped logging, e.g.
+		// threads that ended.
+		if(isReleasingIdle)
+		{
+			if(buffer.isIdle)
+				string().swap(buffer.data);
+			buffer.isIdle = true;
+		}
+	}
+}
+
+
+void FileAppender::closeThreadBuffers()
+{
+	if(_flusher)
+	{
+		_flusher->stop();
+		delete _flusher;
+		_flusher = NULL;
+	}
+
+	MutexLock lock(&_threadBuffersMutex);
+
+	for(vector<ThreadBuffer*>::iterator it = _threadBuffers.begin(); it != _threadBuffers.end(); ++it)
+	{
+		ThreadBuffer& buffer = **it;
+		MutexLock bufferLock(&buffer.mutex);
+		commitThreadBuffer(buffer);
+		buffer.isClosed = true;
+	}
+	_isThreadBuffersClosed = true;
 }
 
 void FileAppender::open(std::ios_base::openmode mode)
@@ -219,6 +970,7 @@ bool FileAppender::reopen()
 		if(_reopen_time <= TimeHelper::gettimeofday() || _reopenDelay == 0)
 		{
 			// Close the current file
+			syncFile();
 			_out.close();
 			// reset flags since the C++ standard specified that all
 			// the flags should remain unchanged on a close
@@ -250,26 +1002,24 @@ RollingFileAppender::RollingFileAppender(const string& filename,
 RollingFileAppender::RollingFileAppender(const Properties& properties)
 	: FileAppender(properties, std::ios_base::app)
 {
-	long tmpMaxFileSize = DEFAULT_ROLLING_LOG_SIZE;
+	long tmpMaxFileSize = getMaxFileSize(properties);
 	int tmpMaxBackupIndex = 1;
-	string tmp(toUpper(properties.getProperty("MaxFileSize")));
-
-	if(!tmp.empty())
-	{
-		tmpMaxFileSize = std::atoi(tmp.c_str());
-		if(tmpMaxFileSize != 0)
-		{
-			string::size_type const len = tmp.length();
-			if(len > 2 && tmp.compare(len - 2, 2, "MB") == 0)
-				tmpMaxFileSize *=(1024 * 1024); // convert to megabytes
-			else if(len > 2 && tmp.compare(len - 2, 2, "KB") == 0)
-				tmpMaxFileSize *= 1024; // convert to kilobytes
-		}
-	}
 
 	properties.getInt(tmpMaxBackupIndex, "MaxBackupIndex");
 
 	init(tmpMaxFileSize, tmpMaxBackupIndex);
+
+	string const namingScheme(toUpper(properties.getProperty("NamingScheme", "INDEX")));
+	if(namingScheme == "SEQUENCE")
+	{
+		bool useSymlink = false;
+		properties.getBool(useSymlink, "SequenceSymlink");
+		setSequenceNaming(useSymlink);
+	}
+	else if(namingScheme != "INDEX")
+	{
+		LogLog::getLogLog()->error("RollingFileAppender- NamingScheme not valid: " + properties.getProperty("NamingScheme"));
+	}
 }
 
 
@@ -286,6 +1036,135 @@ void RollingFileAppender::init(long maxFileSize, int maxBackupIndex)
 
 	_maxFileSize = maxFileSize;
 	_maxBackupIndex =(std::max)(maxBackupIndex, 1);
+
+	_isSequenceNaming = false;
+	_isSymlinked = false;
+	_sequence = 0;
+}
+
+
+void RollingFileAppender::setSequenceNaming(bool useSymlink)
+{
+	MutexLock lock(&_mutex);
+
+	if(_isSequenceNaming)
+		return;
+
+	// The only scan of the directory; from here on the names follow
+	// from the sequence number.
+	_isSequenceNaming = true;
+	_sequence = findHighestIndex(_filename);
+
+#ifdef _MSC_VER
+	if(useSymlink)
+		LogLog::getLogLog()->error("RollingFileAppender- SequenceSymlink is not supported on this platform");
+#else	//__linux__
+	if(!useSymlink)
+		return;
+
+	_isSymlinked = true;
+
+	// A link left by an earlier run points to the file the stream is
+	// already appending to; a plain file becomes the next numbered one.
+	struct stat info;
+	if(lstat(_filename.c_str(), &info) == 0 && S_ISLNK(info.st_mode))
+		return;
+
+	_out.close();
+	_out.clear();
+
+	++_sequence;
+	string const current = getSequenceFilename(_sequence);
+	long const ret = renameFile(_filename, current);
+	loglog_renamingResult(LogLog::getLogLog(), _filename, current, ret);
+
+	_out.open(current.c_str(), std::ios::out | std::ios::app);
+	loglog_openingResult(LogLog::getLogLog(), _out, current);
+	updateSymlink(current);
+#endif
+}
+
+
+string RollingFileAppender::getSequenceFilename(long sequence) const
+{
+	char suffix[32];
+	sprintf(suffix, ".%06ld", sequence);
+	return _filename + suffix;
+}
+
+
+void RollingFileAppender::removeSequenceFile(long sequence)
+{
+	if(sequence < 1)
+		return;
+
+	string const name = getSequenceFilename(sequence);
+	long const ret = removeFile(name);
+	if(ret != 0 && ret != LOG4CPLUS_FILE_NOT_FOUND)
+		LogLog::getLogLog()->error("Failed to remove file " + name + "; error " + convertIntegerToString(ret));
+}
+
+
+//! Points the file name at <code>target</code>: a new link is created
+//! next to it and renamed over it, so the name always resolves.
+void RollingFileAppender::updateSymlink(const string& target)
+{
+#ifdef _MSC_VER
+	(void) target;
+#else	//__linux__
+	string directory;
+	string baseName;
+	splitDirectory(directory, baseName, target);
+
+	string const link = _filename + ".link";
+	unlink(link.c_str());
+	if(symlink(baseName.c_str(), link.c_str()) != 0 || renameFile(link, _filename) != 0)
+	{
+		LogLog::getLogLog()->error("Failed to link " + _filename + " to " + baseName
+			+ ": " + strerror(errno));
+	}
+#endif
+}
+
+
+void RollingFileAppender::rolloverSequence()
+{
+	LogLog* loglog = LogLog::getLogLog();
+
+	// Close the current file
+	syncFile();
+	_out.close();
+	_out.clear();
+
+	string rolled;
+	if(_isSymlinked)
+	{
+		rolled = getSequenceFilename(_sequence);
+
+		// Open the next numbered file and point the link at it.
+		++_sequence;
+		string const current = getSequenceFilename(_sequence);
+		_out.open(current.c_str(), std::ios::out | std::ios::trunc);
+		loglog_openingResult(loglog, _out, current);
+		updateSymlink(current);
+
+		removeSequenceFile(_sequence - _maxBackupIndex - 1);
+	}
+	else
+	{
+		// Rename fileName to the next number, e.g. fileName.000123.
+		++_sequence;
+		rolled = getSequenceFilename(_sequence);
+		long const ret = renameFile(_filename, rolled);
+		loglog_renamingResult(loglog, _filename, rolled, ret);
+
+		open(std::ios::out | std::ios::trunc);
+		loglog_openingResult(loglog, _out, _filename);
+
+		removeSequenceFile(_sequence - _maxBackupIndex);
+	}
+
+	notifyRolled(vector<string>(1, rolled));
 }
 
 
@@ -295,15 +1174,14 @@ RollingFileAppender::~RollingFileAppender()
 }
 
 
-// This method does not need to be locked since it is called by
-// doAppend() which performs the locking
-void RollingFileAppender::append(const InternalLoggingEvent& loggingEvent)
+// Called with _mutex held.
+void RollingFileAppender::writeText(const char* data, size_t length, const TimeHelper& timestamp)
 {
 	// Rotate log file if needed before appending to it.
 	if(_out.tellp() > _maxFileSize)
 		rollover();
 
-	FileAppender::append(loggingEvent);
+	FileAppender::writeText(data, length, timestamp);
 
 	// Rotate log file if needed after appending to it.
 	if(_out.tellp() > _maxFileSize)
@@ -313,9 +1191,16 @@ void RollingFileAppender::append(const InternalLoggingEvent& loggingEvent)
 
 void RollingFileAppender::rollover()
 {
+	if(_isSequenceNaming)
+	{
+		rolloverSequence();
+		return;
+	}
+
 	LogLog* loglog = LogLog::getLogLog();
 
 	// Close the current file
+	syncFile();
 	_out.close();
 	// Reset flags since the C++ standard specified that all the flags
 	// should remain unchanged on a close.
@@ -343,6 +1228,11 @@ void RollingFileAppender::rollover()
 	// Open it up again in truncation mode
 	open(std::ios::out | std::ios::trunc);
 	loglog_openingResult(loglog, _out, _filename);
+
+	vector<string> rolled;
+	for(int i = 1; i <= _maxBackupIndex; ++i)
+		rolled.push_back(_filename + "." + convertIntegerToString(i));
+	notifyRolled(rolled);
 }
 
 
@@ -453,28 +1343,34 @@ DailyRollingFileAppender::~DailyRollingFileAppender()
 
 void DailyRollingFileAppender::close()
 {
-	rollover();
+	// The buffered events belong to the current period.
+	commitThreadBuffers();
+	{
+		MutexLock lock(&_mutex);
+		rollover();
+	}
 	FileAppender::close();
 }
 
 
 
-// This method does not need to be locked since it is called by
-// doAppend() which performs the locking
-void DailyRollingFileAppender::append(const InternalLoggingEvent& loggingEvent)
+// Called with _mutex held. A combined buffer goes to the period of its
+// first event.
+void DailyRollingFileAppender::writeText(const char* data, size_t length, const TimeHelper& timestamp)
 {
-	if(loggingEvent.getTimestamp() >= _nextRolloverTime) 
+	if(timestamp >= _nextRolloverTime) 
 	{
 		rollover();
 	}
 
-	FileAppender::append(loggingEvent);
+	FileAppender::writeText(data, length, timestamp);
 }
 
 
 void DailyRollingFileAppender::rollover()
 {
 	// Close the current file
+	syncFile();
 	_out.close();
 	// reset flags since the C++ standard specified that all the flags
 	// should remain unchanged on a close
@@ -519,6 +1415,11 @@ void DailyRollingFileAppender::rollover()
 	open(std::ios::out | std::ios::trunc);
 	loglog_openingResult(loglog, _out, _filename);
 
+	vector<string> rolled(1, _scheduledFilename);
+	for(int i = 1; i <= _maxBackupIndex; ++i)
+		rolled.push_back(_scheduledFilename + "." + convertIntegerToString(i));
+	notifyRolled(rolled);
+
 	// Calculate the next rollover time
 	TimeHelper now = TimeHelper::gettimeofday();
 	if(now >= _nextRolloverTime)
@@ -604,3 +1505,102 @@ string DailyRollingFileAppender::getFilename(const TimeHelper& t) const
 }
 
 
+
+
+SizeAndTimeRollingFileAppender::SizeAndTimeRollingFileAppender(const string& filename_,
+	DailyRollingFileSchedule schedule_, long maxFileSize_, bool immediateFlush_, bool createDirs_)
+	: DailyRollingFileAppender(filename_, schedule_, immediateFlush_, 0, createDirs_)
+{
+	init(maxFileSize_);
+}
+
+
+SizeAndTimeRollingFileAppender::SizeAndTimeRollingFileAppender(const Properties& properties)
+	: DailyRollingFileAppender(properties)
+{
+	init(getMaxFileSize(properties));
+}
+
+
+void SizeAndTimeRollingFileAppender::init(long maxFileSize)
+{
+	if(maxFileSize < MINIMUM_ROLLING_LOG_SIZE)
+	{
+		ostringstream oss;
+		oss << "SizeAndTimeRollingFileAppender: MaxFileSize property value is too small. Resetting to"
+			<< MINIMUM_ROLLING_LOG_SIZE << ".";
+		LogLog::getLogLog()->error(oss.str());
+		maxFileSize = MINIMUM_ROLLING_LOG_SIZE;
+	}
+
+	_maxFileSize = maxFileSize;
+	_nextIndex = findNextIndex(_scheduledFilename);
+}
+
+
+SizeAndTimeRollingFileAppender::~SizeAndTimeRollingFileAppender()
+{
+	destructorImpl();
+}
+
+
+void SizeAndTimeRollingFileAppender::close()
+{
+	// The buffered events belong to the current period.
+	commitThreadBuffers();
+	{
+		MutexLock lock(&_mutex);
+		if(_out.tellp() > 0)
+			rollover();
+	}
+	FileAppender::close();
+}
+
+
+// Called with _mutex held. A combined buffer goes to the period of its
+// first event.
+void SizeAndTimeRollingFileAppender::writeText(const char* data, size_t length, const TimeHelper& timestamp)
+{
+	if(timestamp >= _nextRolloverTime || _out.tellp() > _maxFileSize)
+		rollover();
+
+	FileAppender::writeText(data, length, timestamp);
+
+	if(_out.tellp() > _maxFileSize)
+		rollover();
+}
+
+
+void SizeAndTimeRollingFileAppender::rollover()
+{
+	LogLog* loglog = LogLog::getLogLog();
+
+	// Close the current file
+	syncFile();
+	_out.close();
+	// reset flags since the C++ standard specified that all the flags
+	// should remain unchanged on a close
+	_out.clear();
+
+	// Rename e.g. "log" to "log.2009-11-07.3"; nothing else is renamed.
+	string const target = _scheduledFilename + "." + convertIntegerToString(_nextIndex);
+	long const ret = renameFile(_filename, target);
+	loglog_renamingResult(loglog, _filename, target, ret);
+	if(ret == 0)
+		++_nextIndex;
+
+	// Open a new file, e.g. "log".
+	open(std::ios::out | std::ios::trunc);
+	loglog_openingResult(loglog, _out, _filename);
+
+	notifyRolled(vector<string>(1, target));
+
+	// Start the index over in a new period.
+	TimeHelper now = TimeHelper::gettimeofday();
+	if(now >= _nextRolloverTime)
+	{
+		_scheduledFilename = getFilename(now);
+		_nextRolloverTime = calculateNextRolloverTime(now);
+		_nextIndex = findNextIndex(_scheduledFilename);
+	}
+}
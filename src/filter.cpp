@@ -8,6 +8,16 @@
 #include "log4cplus/property.h"
 #include "log4cplus/loggingevent.h"
 
+#include <algorithm>
+#include <cstdlib>
+
+#ifdef _MSC_VER
+#include <regex>
+#else
+#include <sys/types.h>
+#include <regex.h>
+#endif
+
 using namespace std;
 using namespace log4cplus;
 
@@ -29,10 +39,20 @@ FilterResult log4cplus::checkFilter(const Filter* filter, const InternalLoggingE
 }
 
 
-Filter::Filter() {}
+Filter::Filter() : _pendingEvents(0) {}
 
 Filter::~Filter() {}
 
+bool Filter::nextPendingEvent(InternalLoggingEvent&) const
+{
+	return false;
+}
+
+bool Filter::decideLevel(LogLevel, FilterResult&) const
+{
+	return false;
+}
+
 void Filter::appendFilter(FilterPtr filter)
 {
 	if(!_nextFilter)
@@ -54,6 +74,13 @@ FilterResult DenyAllFilter::decide(const InternalLoggingEvent&) const
 }
 
 
+bool DenyAllFilter::decideLevel(LogLevel, FilterResult& result) const
+{
+	result = DENY;
+	return true;
+}
+
+
 
 LogLevelMatchFilter::LogLevelMatchFilter()
 {
@@ -76,22 +103,32 @@ void LogLevelMatchFilter::init()
 
 
 FilterResult LogLevelMatchFilter::decide(const InternalLoggingEvent& loggingEvent) const
+{
+	FilterResult result;
+	decideLevel(loggingEvent.getLogLevel(), result);
+	return result;
+}
+
+
+bool LogLevelMatchFilter::decideLevel(LogLevel ll, FilterResult& result) const
 {
 	if(_logLevelToMatch == NOT_SET_LOG_LEVEL) 
 	{
-		return NEUTRAL;
+		result = NEUTRAL;
+		return true;
 	}
 
-	bool matchOccured = (_logLevelToMatch == loggingEvent.getLogLevel());
+	bool matchOccured = (_logLevelToMatch == ll);
 
 	if(matchOccured)
 	{
-		return ACCEPT;
+		result = ACCEPT;
 	}
 	else
 	{
-		return NEUTRAL;
+		result = NEUTRAL;
 	}
+	return true;
 }
 
 
@@ -122,18 +159,568 @@ void LogLevelRangeFilter::init()
 
 FilterResult LogLevelRangeFilter::decide(const InternalLoggingEvent& loggingEvent) const
 {
-	if((_logLevelMin != NOT_SET_LOG_LEVEL) &&(loggingEvent.getLogLevel() < _logLevelMin)) 
+	FilterResult result;
+	decideLevel(loggingEvent.getLogLevel(), result);
+	return result;
+}
+
+
+bool LogLevelRangeFilter::decideLevel(LogLevel ll, FilterResult& result) const
+{
+	if((_logLevelMin != NOT_SET_LOG_LEVEL) &&(ll < _logLevelMin)) 
 	{
 		// priority of loggingEvent is less than minimum
-		return DENY;
+		result = DENY;
+		return true;
 	}
 
-	if((_logLevelMax != NOT_SET_LOG_LEVEL) &&(loggingEvent.getLogLevel() > _logLevelMax)) 
+	if((_logLevelMax != NOT_SET_LOG_LEVEL) &&(ll > _logLevelMax)) 
 	{
 		// priority of loggingEvent is greater than maximum
-		return DENY;
+		result = DENY;
+		return true;
 	}
 
-	return ACCEPT;
+	result = ACCEPT;
+	return true;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TokenBucketFilter
+///////////////////////////////////////////////////////////////////////////////
+
+static unsigned int hashString(const string& str, unsigned int h = 2166136261u)
+{
+	// FNV-1a
+	for(string::size_type i = 0; i < str.size(); ++i)
+	{
+		h ^= static_cast<unsigned char>(str[i]);
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+static unsigned int roundUpToPowerOfTwo(unsigned int n)
+{
+	unsigned int r = 1;
+	while(r < n && r < 0x80000000u)
+		r <<= 1;
+	return r;
+}
+
+
+TokenBucketFilter::TokenBucketFilter(unsigned int rate, unsigned int burst, KeyType key, unsigned int buckets)
+{
+	init(rate, burst, key, buckets);
+}
+
+
+TokenBucketFilter::TokenBucketFilter(const Properties& properties)
+{
+	unsigned int rate = 0;
+	properties.getUInt(rate, "Rate");
+
+	unsigned int burst = rate;
+	properties.getUInt(burst, "Burst");
+
+	unsigned int buckets = 64;
+	properties.getUInt(buckets, "Buckets");
+
+	KeyType key = GLOBAL_KEY;
+	string const keyStr = toLower(properties.getProperty("Key"));
+	if(keyStr == "logger")
+		key = LOGGER_KEY;
+	else if(keyStr == "message")
+		key = MESSAGE_KEY;
+	else if(!keyStr.empty())
+		LogLog::getLogLog()->error("TokenBucketFilter- Key not valid: " + keyStr);
+
+	init(rate, burst, key, buckets);
+}
+
+
+void TokenBucketFilter::init(unsigned int rate, unsigned int burst, KeyType key, unsigned int buckets)
+{
+	_key = key;
+	_suppressed = 0;
+
+	// A zero interval disables the limit.
+	_intervalNanos = rate ? 1000000000LL / rate : 0;
+	_toleranceNanos = _intervalNanos * ((std::max)(burst, 1u));
+
+	unsigned int const size = (key == GLOBAL_KEY) ? 1 : roundUpToPowerOfTwo((std::max)(buckets, 1u));
+	_bucketMask = size - 1;
+	_buckets = new AtomicInt64[size];
+	for(unsigned int i = 0; i < size; ++i)
+		_buckets[i] = 0;
+}
+
+
+TokenBucketFilter::~TokenBucketFilter()
+{
+	delete[] _buckets;
+}
+
+
+FilterResult TokenBucketFilter::decide(const InternalLoggingEvent& loggingEvent) const
+{
+	if(_intervalNanos == 0)
+		return NEUTRAL;
+
+	unsigned int index = 0;
+	if(_key == LOGGER_KEY)
+		index = hashString(loggingEvent.getLoggerName()) & _bucketMask;
+	else if(_key == MESSAGE_KEY)
+		index = hashString(loggingEvent.getMessage()) & _bucketMask;
+
+	TimeHelper const& ts = loggingEvent.getTimestamp();
+	AtomicInt64 const now = static_cast<AtomicInt64>(ts.sec()) * 1000000000LL + ts.usec() * 1000LL;
+
+	volatile AtomicInt64* bucket = &_buckets[index];
+	AtomicInt64 tat = atomicLoad64(bucket);
+	for(;;)
+	{
+		AtomicInt64 const newTat = (tat > now ? tat : now) + _intervalNanos;
+		if(newTat - now > _toleranceNanos)
+		{
+			atomicAdd64(&_suppressed, 1);
+			return DENY;
+		}
+
+		AtomicInt64 const seen = atomicCompareExchange64(bucket, tat, newTat);
+		if(seen == tat)
+			return NEUTRAL;
+		tat = seen;
+	}
+}
+
+
+AtomicInt64 TokenBucketFilter::getSuppressedCount() const
+{
+	return atomicLoad64(&_suppressed);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SamplingFilter
+///////////////////////////////////////////////////////////////////////////////
+
+SamplingFilter::SamplingFilter(unsigned int sampleEvery)
+{
+	init();
+	_sampleEvery = (std::max)(sampleEvery, 1u);
+}
+
+
+SamplingFilter::SamplingFilter(const Properties& properties)
+{
+	init();
+
+	properties.getUInt(_sampleEvery, "SampleEvery");
+	_sampleEvery = (std::max)(_sampleEvery, 1u);
+
+	string const& probability = properties.getProperty("Probability");
+	if(!probability.empty())
+	{
+		double p = std::atof(probability.c_str());
+		p = (std::min)((std::max)(p, 0.0), 1.0);
+		_isProbabilistic = true;
+		_threshold = static_cast<unsigned long long>(p * 4294967296.0);
+	}
+
+	properties.getUInt(_seed, "Seed");
+	if(_seed == 0)
+		_seed = 2463534242u;	// xorshift state must not be zero
+}
+
+
+void SamplingFilter::init()
+{
+	_sampleEvery = 1;
+	_isProbabilistic = false;
+	_threshold = 0;
+	_seed = 2463534242u;
+	_suppressed = 0;
+	_stateKey = TLSInit(0);
+}
+
+
+SamplingFilter::~SamplingFilter()
+{
+	TLSCleanup(_stateKey);
+}
+
+
+FilterResult SamplingFilter::decide(const InternalLoggingEvent&) const
+{
+	// The thread's counter or random state is stored in the TLS slot
+	// itself. Zero means "not started yet" in both modes.
+	std::size_t state = reinterpret_cast<std::size_t>(TLSGetValue(_stateKey));
+	bool keep;
+
+	if(_isProbabilistic)
+	{
+		unsigned int x = state ? static_cast<unsigned int>(state) : _seed;
+		// xorshift32
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		state = x;
+		keep = x < _threshold;
+	}
+	else
+	{
+		keep = (state == 0);
+		state = (state + 1 == _sampleEvery) ? 0 : state + 1;
+	}
+
+	TLSSetValue(_stateKey, reinterpret_cast<TLSValueType>(state));
+
+	if(keep)
+		return NEUTRAL;
+
+	atomicAdd64(&_suppressed, 1);
+	return DENY;
+}
+
+
+AtomicInt64 SamplingFilter::getSuppressedCount() const
+{
+	return atomicLoad64(&_suppressed);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// DuplicateSuppressionFilter
+///////////////////////////////////////////////////////////////////////////////
+
+// Slot keys: anything else is the hash of the (logger, LogLevel, message)
+// triple owning the slot.
+static AtomicInt64 const SLOT_EMPTY = 0;
+static AtomicInt64 const SLOT_BUSY = 1;
+
+
+struct DuplicateSuppressionFilter::Slot
+{
+	volatile AtomicInt64 key;
+	volatile AtomicInt64 windowEnd;
+	volatile AtomicInt repeats;
+
+	// Only written by the thread that moved key to SLOT_BUSY.
+	string loggerName;
+	LogLevel ll;
+};
+
+
+static AtomicInt64 hashEvent(const InternalLoggingEvent& loggingEvent)
+{
+	// FNV-1a, 64 bit
+	unsigned long long h = 14695981039346656037ULL;
+	string const* parts[2] = { &loggingEvent.getLoggerName(), &loggingEvent.getMessage() };
+	for(int p = 0; p < 2; ++p)
+	{
+		string const& str = *parts[p];
+		for(string::size_type i = 0; i < str.size(); ++i)
+		{
+			h ^= static_cast<unsigned char>(str[i]);
+			h *= 1099511628211ULL;
+		}
+		h ^= static_cast<unsigned long long>(loggingEvent.getLogLevel()) + p;
+		h *= 1099511628211ULL;
+	}
+
+	AtomicInt64 key = static_cast<AtomicInt64>(h & 0x7FFFFFFFFFFFFFFFULL);
+	return key > SLOT_BUSY ? key : key + 2;
+}
+
+
+DuplicateSuppressionFilter::DuplicateSuppressionFilter(int windowSeconds, unsigned int tableSize)
+{
+	init(windowSeconds, tableSize);
+}
+
+
+DuplicateSuppressionFilter::DuplicateSuppressionFilter(const Properties& properties)
+{
+	int windowSeconds = 10;
+	properties.getInt(windowSeconds, "Window");
+
+	unsigned int tableSize = 64;
+	properties.getUInt(tableSize, "TableSize");
+
+	init(windowSeconds, tableSize);
+}
+
+
+void DuplicateSuppressionFilter::init(int windowSeconds, unsigned int tableSize)
+{
+	_windowMicros = static_cast<AtomicInt64>((std::max)(windowSeconds, 0)) * 1000000;
+	_nextSweep = 0;
+	_suppressed = 0;
+
+	unsigned int const size = roundUpToPowerOfTwo((std::max)(tableSize, 1u));
+	_slotMask = size - 1;
+	_slots = new Slot[size];
+	for(unsigned int i = 0; i < size; ++i)
+	{
+		_slots[i].key = SLOT_EMPTY;
+		_slots[i].windowEnd = 0;
+		_slots[i].repeats = 0;
+		_slots[i].ll = NOT_SET_LOG_LEVEL;
+	}
+}
+
+
+DuplicateSuppressionFilter::~DuplicateSuppressionFilter()
+{
+	delete[] _slots;
+}
+
+
+FilterResult DuplicateSuppressionFilter::decide(const InternalLoggingEvent& loggingEvent) const
+{
+	TimeHelper const& ts = loggingEvent.getTimestamp();
+	AtomicInt64 const now = static_cast<AtomicInt64>(ts.sec()) * 1000000 + ts.usec();
+
+	// Report repeats of messages that stopped recurring.
+	if(now >= atomicLoad64(&_nextSweep))
+		sweep(now);
+
+	AtomicInt64 const key = hashEvent(loggingEvent);
+	Slot& slot = _slots[static_cast<unsigned int>(key) & _slotMask];
+	AtomicInt64 const current = atomicLoad64(&slot.key);
+
+	if(current == key)
+	{
+		if(now < atomicLoad64(&slot.windowEnd))
+		{
+			atomicIncrement(&slot.repeats);
+			atomicAdd64(&_suppressed, 1);
+			return DENY;
+		}
+
+		// The window has passed: report it and start a new one.
+		if(atomicCompareExchange64(&slot.key, key, SLOT_BUSY) == key)
+		{
+			reportRepeats(slot);
+			atomicStore64(&slot.windowEnd, now + _windowMicros);
+			atomicStore64(&slot.key, key);
+		}
+		return NEUTRAL;
+	}
+
+	if(current == SLOT_BUSY)
+		return NEUTRAL;
+
+	// Empty slot or a different message: take the slot over.
+	if(atomicCompareExchange64(&slot.key, current, SLOT_BUSY) == current)
+	{
+		if(current != SLOT_EMPTY)
+			reportRepeats(slot);
+
+		slot.loggerName = loggingEvent.getLoggerName();
+		slot.ll = loggingEvent.getLogLevel();
+		atomicExchange(&slot.repeats, 0);
+		atomicStore64(&slot.windowEnd, now + _windowMicros);
+		atomicStore64(&slot.key, key);
+	}
+
+	return NEUTRAL;
+}
+
+
+void DuplicateSuppressionFilter::sweep(AtomicInt64 now) const
+{
+	// Only one thread sweeps per window.
+	AtomicInt64 const due = atomicLoad64(&_nextSweep);
+	if(now < due || atomicCompareExchange64(&_nextSweep, due, now + _windowMicros) != due)
+		return;
+
+	for(unsigned int i = 0; i <= _slotMask; ++i)
+	{
+		Slot& slot = _slots[i];
+		AtomicInt64 const key = atomicLoad64(&slot.key);
+		if(key == SLOT_EMPTY || key == SLOT_BUSY || slot.repeats == 0)
+			continue;
+		if(now < atomicLoad64(&slot.windowEnd))
+			continue;
+
+		if(atomicCompareExchange64(&slot.key, key, SLOT_BUSY) == key)
+		{
+			reportRepeats(slot);
+			atomicStore64(&slot.key, key);
+		}
+	}
+}
+
+
+// The caller owns the slot (its key is SLOT_BUSY).
+void DuplicateSuppressionFilter::reportRepeats(Slot& slot) const
+{
+	AtomicInt const repeats = atomicExchange(&slot.repeats, 0);
+	if(repeats == 0)
+		return;
+
+	Summary summary;
+	summary.loggerName = slot.loggerName;
+	summary.ll = slot.ll;
+	summary.repeats = repeats;
+
+	MutexLock lock(&_summaryMutex);
+	_summaries.push_back(summary);
+	atomicIncrement(&_pendingEvents);
+}
+
+
+bool DuplicateSuppressionFilter::nextPendingEvent(InternalLoggingEvent& loggingEvent) const
+{
+	if(_pendingEvents == 0)
+		return false;
+
+	Summary summary;
+	{
+		MutexLock lock(&_summaryMutex);
+		if(_summaries.empty())
+			return false;
+
+		summary = _summaries.front();
+		_summaries.erase(_summaries.begin());
+		atomicDecrement(&_pendingEvents);
+	}
+
+	loggingEvent.setLoggingEvent(summary.loggerName, summary.ll,
+		"last message repeated " + convertIntegerToString(summary.repeats) + " times");
+	return true;
+}
+
+
+AtomicInt64 DuplicateSuppressionFilter::getSuppressedCount() const
+{
+	return atomicLoad64(&_suppressed);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// StringMatchFilter
+///////////////////////////////////////////////////////////////////////////////
+
+StringMatchFilter::StringMatchFilter(const string& stringToMatch, bool acceptOnMatch)
+	: _searcher(stringToMatch), _acceptOnMatch(acceptOnMatch)
+{
+}
+
+
+StringMatchFilter::StringMatchFilter(const Properties& properties)
+	: _searcher(properties.getProperty("StringToMatch")), _acceptOnMatch(true)
+{
+	properties.getBool(_acceptOnMatch, "AcceptOnMatch");
+}
+
+
+FilterResult StringMatchFilter::decide(const InternalLoggingEvent& loggingEvent) const
+{
+	if(_searcher.getNeedle().empty())
+		return NEUTRAL;
+
+	if(_searcher.find(loggingEvent.getMessage()) == string::npos)
+		return NEUTRAL;
+
+	return _acceptOnMatch ? ACCEPT : DENY;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// RegexFilter
+///////////////////////////////////////////////////////////////////////////////
+
+struct RegexFilter::CompiledRegex
+{
+#ifdef _MSC_VER
+	std::tr1::regex regex;
+#else
+	regex_t regex;
+#endif
+};
+
+
+RegexFilter::RegexFilter(const string& pattern, bool acceptOnMatch)
+	: _regex(0), _acceptOnMatch(acceptOnMatch)
+{
+	init(pattern);
+}
+
+
+RegexFilter::RegexFilter(const Properties& properties)
+	: _regex(0), _acceptOnMatch(true)
+{
+	properties.getBool(_acceptOnMatch, "AcceptOnMatch");
+	init(properties.getProperty("Pattern"));
+}
+
+
+void RegexFilter::init(const string& pattern)
+{
+	if(pattern.empty())
+	{
+		LogLog::getLogLog()->error("RegexFilter- Pattern not specified");
+		return;
+	}
+
+	std::auto_ptr<CompiledRegex> compiled(new CompiledRegex);
+
+#ifdef _MSC_VER
+	try
+	{
+		compiled->regex.assign(pattern, std::tr1::regex::extended | std::tr1::regex::nosubs);
+	}
+	catch(std::exception const& e)
+	{
+		LogLog::getLogLog()->error("RegexFilter- Invalid pattern " + pattern + ": " + e.what());
+		return;
+	}
+#else
+	int const ret = regcomp(&compiled->regex, pattern.c_str(), REG_EXTENDED | REG_NOSUB);
+	if(ret != 0)
+	{
+		char buf[256];
+		regerror(ret, &compiled->regex, buf, sizeof(buf));
+		LogLog::getLogLog()->error("RegexFilter- Invalid pattern " + pattern + ": " + buf);
+		return;
+	}
+#endif
+
+	_regex = compiled.release();
+}
+
+
+RegexFilter::~RegexFilter()
+{
+	if(_regex)
+	{
+#ifndef _MSC_VER
+		regfree(&_regex->regex);
+#endif
+		delete _regex;
+	}
 }
 
+
+FilterResult RegexFilter::decide(const InternalLoggingEvent& loggingEvent) const
+{
+	if(!_regex)
+		return NEUTRAL;
+
+#ifdef _MSC_VER
+	bool const matched = std::tr1::regex_search(loggingEvent.getMessage(), _regex->regex);
+#else
+	bool const matched = regexec(&_regex->regex, loggingEvent.getMessage().c_str(), 0, 0, 0) == 0;
+#endif
+
+	if(!matched)
+		return NEUTRAL;
+
+	return _acceptOnMatch ? ACCEPT : DENY;
+}
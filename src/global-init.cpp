@@ -10,11 +10,13 @@
 #include "log4cplus/hierarchy.h"
 #include "log4cplus/mutex.h"
 #include "log4cplus/fileappender.h"
+#include "log4cplus/environment.h"
 
 #include <cstdio>
 #include <iostream>
 #include <stdexcept>
 #include <memory>
+#include <map>
 
 
 using namespace log4cplus;
@@ -29,6 +31,8 @@ struct DefaultContext
 	AppenderFactoryRegistry appenderFactoryRegistry;
 	LayoutFactoryRegistry	layoutFactoryRegistry;
 	FilterFactoryRegistry	filterFactoryRegistry;
+	std::map<std::string, unsigned int> layoutShareIds;
+	Mutex layoutShareIdsMutex;
 };
 
 
@@ -93,6 +97,20 @@ TimeHelper const& log4cplus::getLayoutTimeBase()
 }
 
 
+unsigned int log4cplus::getLayoutShareId(const std::string& formatKey)
+{
+	if(formatKey.empty())
+		return 0;
+
+	DefaultContext* const dc = getDC();
+	MutexLock lock(&dc->layoutShareIdsMutex);
+	unsigned int& id = dc->layoutShareIds[formatKey];
+	if(id == 0)
+		id = static_cast<unsigned int>(dc->layoutShareIds.size());
+	return id;
+}
+
+
 LogLevelManager& log4cplus::getLogLevelManager() 
 {
 	return getDC()->logLevelManager;
@@ -162,6 +180,18 @@ static void threadSetup()
 }
 
 
+#ifndef _MSC_VER
+//!Renders the process and thread ids cached for the layouts again in
+//!the child process, whose forking thread keeps its event.
+static void forkChildHandler()
+{
+	refreshProcessId();
+	if(InternalLoggingEvent* ev = getInternalLoggingEvent(false))
+		ev->refreshThread();
+}
+#endif
+
+
 static void initRootLogger()
 {
 	SharedAppenderPtr _append(new RollingFileAppender("root_default.log", 200*1024, 3));
@@ -179,6 +209,9 @@ void log4cplus::initializeLog4cplus()
 
 	log4cplus::g_TLS_StorageKey = TLSInit(ptdCleanupFunc);
 	threadSetup();
+#ifndef _MSC_VER
+	pthread_atfork(NULL, NULL, forkChildHandler);
+#endif
 
 	DefaultContext* dc = getDC(true);
 	dc->baseLayoutTime = TimeHelper::gettimeofday();
@@ -13,7 +13,7 @@ using namespace std;
 using namespace log4cplus;
 
 
-Hierarchy::Hierarchy() : defaultFactory(new DefaultLoggerFactory()), root(NULL)
+Hierarchy::Hierarchy() : _hashtable_mutex("Hierarchy"), defaultFactory(new DefaultLoggerFactory()), root(NULL)
 	// Don't disable any LogLevel level by default.
 	, _nDisableValue(NOT_SET_LOG_LEVEL), _isEmittedNoAppenderWarning(false)
 {
@@ -147,6 +147,8 @@ Logger Hierarchy::getInstanceImpl(const string& name, LoggerFactory& factory)
 		if (pnm_it != provisionNodes.end())
 		{
 			updateChildren(pnm_it->second, logger);
+			// The children's flattened appender sets now miss the new parent.
+			AppenderAttachableImpl::notifyChange();
 			bool deleted = (provisionNodes.erase(name) > 0);
 			if (!deleted)
 			{
@@ -0,0 +1,235 @@
+// Module:  Log4CPLUS
+// File:    jsonlayout.cpp
+
+#include "log4cplus/layout.h"
+#include "log4cplus/loglog.h"
+#include "log4cplus/timehelper.h"
+#include "log4cplus/stringhelper.h"
+#include "log4cplus/property.h"
+#include "log4cplus/loggingevent.h"
+#include "log4cplus/environment.h"
+
+#include <ostream>
+#include <typeinfo>
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+//! Returns the member name as "name": preceded by a comma unless it is
+//! the first member, or an empty string for an omitted field.
+static string makeKey(const string& name, bool& first)
+{
+	if(name.empty())
+		return string();
+
+	string key(first ? "\"" : ",\"");
+	appendJsonEscaped(key, name.data(), name.size());
+	key += "\":";
+	first = false;
+	return key;
+}
+
+
+JsonLayout::JsonLayout() : _cachedSecond(-1)
+{
+	init(Properties());
+}
+
+
+JsonLayout::JsonLayout(const Properties& properties) : Layout(properties), _cachedSecond(-1)
+{
+	init(properties);
+}
+
+
+JsonLayout::~JsonLayout() {}
+
+
+void JsonLayout::init(const Properties& properties)
+{
+	bool first = true;
+	_timestampKey = makeKey(properties.getProperty("TimestampField", "timestamp"), first);
+	_levelKey = makeKey(properties.getProperty("LevelField", "level"), first);
+	_loggerKey = makeKey(properties.getProperty("LoggerField", "logger"), first);
+	_pidKey = makeKey(properties.getProperty("PidField", "pid"), first);
+	_threadKey = makeKey(properties.getProperty("ThreadField", "thread"), first);
+	_messageKey = makeKey(properties.getProperty("MessageField", "message"), first);
+
+	string const format = toUpper(properties.getProperty("TimestampFormat", "ISO8601"));
+	if(format == "EPOCHMICROS")
+		_timestampFormat = EPOCH_MICROS_TIMESTAMP;
+	else
+	{
+		if(format != "ISO8601")
+			LogLog::getLogLog()->error("JsonLayout- Unknown TimestampFormat " + format + ", using ISO8601");
+		_timestampFormat = ISO8601_TIMESTAMP;
+	}
+}
+
+
+std::auto_ptr<Layout> JsonLayout::clone() const
+{
+	if(typeid(*this) != typeid(JsonLayout))
+		return std::auto_ptr<Layout>();
+
+	std::auto_ptr<JsonLayout> layout(new JsonLayout);
+	layout->_timestampKey = _timestampKey;
+	layout->_levelKey = _levelKey;
+	layout->_loggerKey = _loggerKey;
+	layout->_pidKey = _pidKey;
+	layout->_threadKey = _threadKey;
+	layout->_messageKey = _messageKey;
+	layout->_timestampFormat = _timestampFormat;
+	return std::auto_ptr<Layout>(layout.release());
+}
+
+
+string JsonLayout::getFormatKey() const
+{
+	string key(typeid(*this).name());
+	key += _timestampFormat == EPOCH_MICROS_TIMESTAMP ? ":EpochMicros:" : ":ISO8601:";
+	const string* const keys[] = { &_timestampKey, &_levelKey, &_loggerKey, &_pidKey, &_threadKey, &_messageKey };
+	for(size_t i = 0; i < sizeof(keys) / sizeof(keys[0]); ++i)
+	{
+		key += *keys[i];
+		key += '\n';	// keeps an omitted field apart from a renamed one
+	}
+	return key;
+}
+
+
+void JsonLayout::appendTimestamp(const TimeHelper& timestamp)
+{
+	if(_timestampFormat == EPOCH_MICROS_TIMESTAMP)
+	{
+		appendIntegerToString(_buffer, static_cast<long long>(timestamp.sec()) * 1000000 + timestamp.usec());
+		return;
+	}
+
+	// Only the microseconds change between events of the same second.
+	time_t const sec = timestamp.sec();
+	if(sec != _cachedSecond)
+	{
+		struct tm tm;
+#ifdef _MSC_VER
+		gmtime_s(&tm, &sec);
+#else
+		gmtime_r(&sec, &tm);
+#endif
+		char dateTime[32];
+		size_t const length = strftime(dateTime, sizeof(dateTime), "%Y-%m-%dT%H:%M:%S", &tm);
+		_cachedDateTime.assign(dateTime, length);
+		_cachedSecond = sec;
+	}
+
+	long const usec = timestamp.usec();
+	char fraction[9] = { '.', '0', '0', '0', '0', '0', '0', 'Z', '"' };
+	for(int i = 6, value = usec; i > 0; --i, value /= 10)
+		fraction[i] = static_cast<char>('0' + value % 10);
+
+	_buffer += '"';
+	_buffer += _cachedDateTime;
+	_buffer.append(fraction, sizeof(fraction));
+}
+
+
+void JsonLayout::appendField(const LogField& field)
+{
+	if(_buffer.size() > 1)
+		_buffer += ',';
+	_buffer += '"';
+	appendJsonEscaped(_buffer, field.getKey().data(), field.getKey().size());
+	_buffer += "\":";
+
+	switch(field.getType())
+	{
+	case LogField::DOUBLE_FIELD:
+		{
+			// JSON has no representation for NaN and infinities.
+			double const value = field.getDouble();
+			if(value != value || value - value != 0)
+				_buffer += "null";
+			else
+				field.appendValue(_buffer);
+		}
+		break;
+
+	case LogField::STRING_FIELD:
+		_buffer += '"';
+		appendJsonEscaped(_buffer, field.getString().data(), field.getString().size());
+		_buffer += '"';
+		break;
+
+	default:
+		field.appendValue(_buffer);
+		break;
+	}
+}
+
+
+void JsonLayout::formatAndAppend(ostream& output, const InternalLoggingEvent& loggingEvent)
+{
+	OStreamByteSink sink(output);
+	format(sink, loggingEvent);
+}
+
+
+void JsonLayout::format(ByteSink& sink, const InternalLoggingEvent& loggingEvent)
+{
+	_buffer.clear();
+	_buffer += '{';
+
+	if(!_timestampKey.empty())
+	{
+		_buffer += _timestampKey;
+		appendTimestamp(loggingEvent.getTimestamp());
+	}
+
+	if(!_levelKey.empty())
+	{
+		string const& level = _llmCache.toString(loggingEvent.getLogLevel());
+		_buffer += _levelKey;
+		_buffer += '"';
+		_buffer += level;
+		_buffer += '"';
+	}
+
+	if(!_loggerKey.empty())
+	{
+		string const& logger = loggingEvent.getLoggerName();
+		_buffer += _loggerKey;
+		_buffer += '"';
+		appendJsonEscaped(_buffer, logger.data(), logger.size());
+		_buffer += '"';
+	}
+
+	if(!_pidKey.empty())
+	{
+		_buffer += _pidKey;
+		appendIntegerToString(_buffer, getProcessId());
+	}
+
+	if(!_threadKey.empty())
+	{
+		_buffer += _threadKey;
+		_buffer += loggingEvent.getThread();
+	}
+
+	if(!_messageKey.empty())
+	{
+		string const& message = loggingEvent.getMessage();
+		_buffer += _messageKey;
+		_buffer += '"';
+		appendJsonEscaped(_buffer, message.data(), message.size());
+		_buffer += '"';
+	}
+
+	unsigned int const count = loggingEvent.getFieldCount();
+	for(unsigned int i = 0; i < count; ++i)
+		appendField(loggingEvent.getField(i));
+
+	_buffer += "}\n";
+	sink.append(_buffer);
+}
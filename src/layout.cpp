@@ -8,22 +8,24 @@
 #include "log4cplus/loggingevent.h"
 #include "log4cplus/property.h"
 #include <ostream>
-#include <iomanip>
+#include <cstdio>
+#include <typeinfo>
 
 using namespace std;
 using namespace log4cplus;
 
-void formatRelativeTimestamp (ostream & output, InternalLoggingEvent const& loggingEvent)
+//! Writes the milliseconds since getLayoutTimeBase().
+static void appendRelativeTimestamp(ByteSink& sink, InternalLoggingEvent const& loggingEvent)
 {
-	TimeHelper const rel_time = loggingEvent.getTimestamp () - getLayoutTimeBase ();
-	char const old_fill = output.fill ();
-	time_t const sec = rel_time.sec ();
-
-	if (sec != 0)
-		output << sec << std::setfill ('0') << std::setw (3);
-
-	output << rel_time.usec () / 1000;
-	output.fill (old_fill);
+	TimeHelper const rel_time = loggingEvent.getTimestamp() - getLayoutTimeBase();
+	long long const sec = rel_time.sec();
+	long const msec = rel_time.usec() / 1000;
+
+	char* const room = sink.reserve(32);
+	int const length = sec != 0
+		? sprintf(room, "%lld%03ld", sec, msec)
+		: sprintf(room, "%ld", msec);
+	sink.commit(length > 0 ? length : 0);
 }
 
 
@@ -34,6 +36,29 @@ Layout::Layout (const Properties&) : _llmCache(getLogLevelManager()) {}
 Layout::~Layout() {}
 
 
+void Layout::format(ByteSink& sink, const InternalLoggingEvent& loggingEvent)
+{
+	if(!_sinkStream.get())
+		_sinkStream.reset(new ByteSinkStream);
+
+	_sinkStream->setSink(&sink);
+	formatAndAppend(*_sinkStream, loggingEvent);
+	_sinkStream->setSink(NULL);
+}
+
+
+string Layout::getFormatKey() const
+{
+	return string();
+}
+
+
+std::auto_ptr<Layout> Layout::clone() const
+{
+	return std::auto_ptr<Layout>();
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // SimpleLayout 
 ///////////////////////////////////////////////////////////////////////////////
@@ -47,13 +72,36 @@ SimpleLayout::~SimpleLayout() {}
 void SimpleLayout::formatAndAppend(ostream& output, const InternalLoggingEvent& loggingEvent)
 {
 	output.clear();
-	formatRelativeTimestamp (output, loggingEvent);
-
-	output << " - "
-		<< _llmCache.toString(loggingEvent.getLogLevel()) 
-		<< " - "
-		<< loggingEvent.getMessage() 
-		<< "\n"
-		<< std::ends;
+	OStreamByteSink sink(output);
+	format(sink, loggingEvent);
+}
+
+
+void SimpleLayout::format(ByteSink& sink, const InternalLoggingEvent& loggingEvent)
+{
+	appendRelativeTimestamp(sink, loggingEvent);
+	sink.append(" - ", 3);
+	sink.append(_llmCache.toString(loggingEvent.getLogLevel()));
+	sink.append(" - ", 3);
+	sink.append(loggingEvent.getMessage());
+
+	// Followed by the NUL std::ends used to write.
+	sink.append("\n", 2);
+}
+
+
+string SimpleLayout::getFormatKey() const
+{
+	// A derived layout may write something else.
+	return typeid(*this).name();
+}
+
+
+std::auto_ptr<Layout> SimpleLayout::clone() const
+{
+	if(typeid(*this) != typeid(SimpleLayout))
+		return std::auto_ptr<Layout>();
+
+	return std::auto_ptr<Layout>(new SimpleLayout);
 }
 
@@ -140,6 +140,12 @@ void Logger::removeAppender(const string& name)
 }
 
 
+void Logger::setAppenders(const SharedAppenderPtrList& appenders)
+{
+	_pLoggerImpl->setAppenders(appenders);
+}
+
+
 void Logger::closeNestedAppenders() const
 {
 	_pLoggerImpl->closeNestedAppenders();
@@ -194,6 +200,18 @@ void Logger::setLogLevel(LogLevel ll)
 }
 
 
+bool Logger::getAdditivity() const
+{
+	return _pLoggerImpl->getAdditivity();
+}
+
+
+void Logger::setAdditivity(bool additivity)
+{
+	_pLoggerImpl->setAdditivity(additivity);
+}
+
+
 Hierarchy& Logger::getHierarchy() const
 { 
 	return _pLoggerImpl->getHierarchy();
@@ -9,29 +9,100 @@
 #include "log4cplus/loggingevent.h"
 #include "log4cplus/rootlogger.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace log4cplus;	
 
 
+namespace log4cplus
+{
+	struct FlattenedAppenders
+	{
+		AtomicInt changeCount;
+		SharedAppenderPtrList appenders;
+
+		//! Set if two of the appenders have layouts with the same share
+		//! id, so dispatching lets them format each event once.
+		bool shareFormatting;
+	};
+}
+
+
+namespace
+{
+	//! Leaves callAppenders() even when an appender throws.
+	struct DispatchGuard
+	{
+		explicit DispatchGuard(volatile AtomicInt* dispatching) : _dispatching(dispatching)
+		{
+			atomicIncrement(_dispatching);
+		}
+
+		~DispatchGuard()
+		{
+			atomicDecrement(_dispatching);
+		}
+
+		volatile AtomicInt* _dispatching;
+	};
+
+
+	//! Ends the format sharing of an event, so a later dispatch of it by
+	//! a logger whose appenders do not share starts clean.
+	struct FormatSharingGuard
+	{
+		FormatSharingGuard(const InternalLoggingEvent& loggingEvent, bool enable)
+			: _loggingEvent(loggingEvent), _isEnabled(enable)
+		{
+			if(_isEnabled)
+				_loggingEvent.setFormatSharing(true);
+		}
+
+		~FormatSharingGuard()
+		{
+			if(_isEnabled)
+				_loggingEvent.setFormatSharing(false);
+		}
+
+		const InternalLoggingEvent& _loggingEvent;
+		bool _isEnabled;
+	};
+}
+
+
 LoggerImpl::LoggerImpl(const string& name_, Hierarchy& h)
-	: _name(name_), _ll(NOT_SET_LOG_LEVEL), _parent(NULL), _hierarchy(h)
+	: _name(name_), _ll(NOT_SET_LOG_LEVEL), _parent(NULL), _additivity(true), _hierarchy(h)
+	, _flattenedAppenders(NULL), _dispatching(0), _flattenMutex("LoggerImpl::_flattenMutex")
 {
 }
 
 LoggerImpl::~LoggerImpl() 
 { 
+	delete _flattenedAppenders;
+	for(vector<FlattenedAppenders*>::iterator it = _retiredAppenders.begin(); it != _retiredAppenders.end(); ++it)
+		delete *it;
 }
 
 void LoggerImpl::callAppenders(const InternalLoggingEvent& loggingEvent)
 {
-	int writes = 0;
-	for(const LoggerImpl* c = this; c != NULL; c=c->_parent.get())
-	{
-		writes += c->appendLoopOnAppenders(loggingEvent);
-	}
+	// Read the change count first: a change made while the list is built
+	// then leaves it stale rather than marking a stale list current.
+	AtomicInt const changeCount = getChangeCount();
+
+	DispatchGuard guard(&_dispatching);
+	FlattenedAppenders* flattened = _flattenedAppenders;
+	if(!flattened || flattened->changeCount != changeCount)
+		flattened = getFlattenedAppenders(changeCount);
+
+	// Not modified once published; non-const only for SharedPtr::operator->.
+	SharedAppenderPtrList& appenders = flattened->appenders;
+	FormatSharingGuard sharing(loggingEvent, flattened->shareFormatting);
+	for(SharedAppenderPtrList::iterator it = appenders.begin(); it != appenders.end(); ++it)
+		(*it)->doAppend(loggingEvent);
 
 	// No appenders in hierarchy, warn user only once.
-	if(!_hierarchy._isEmittedNoAppenderWarning && writes == 0) 
+	if(!_hierarchy._isEmittedNoAppenderWarning && appenders.empty()) 
 	{
 		LogLog::getLogLog()->error("No appenders could be found for logger(" + getName() + ").");
 		LogLog::getLogLog()->error("Please initialize the log4cplus system properly.");
@@ -40,6 +111,68 @@ void LoggerImpl::callAppenders(const InternalLoggingEvent& loggingEvent)
 }
 
 
+FlattenedAppenders* LoggerImpl::getFlattenedAppenders(AtomicInt changeCount)
+{
+	MutexLock lock(&_flattenMutex);
+
+	FlattenedAppenders* const current = _flattenedAppenders;
+	if(current && current->changeCount == changeCount)
+		return current;		// built by another thread meanwhile
+
+	std::auto_ptr<FlattenedAppenders> flattened(new FlattenedAppenders);
+	flattened->changeCount = changeCount;
+	flattened->shareFormatting = false;
+	for(LoggerImpl* c = this; c != NULL; c = c->_parent.get())
+	{
+		SharedAppenderPtrList const appenders = c->getAllAppenders();
+		for(SharedAppenderPtrList::const_iterator it = appenders.begin(); it != appenders.end(); ++it)
+		{
+			if(std::find(flattened->appenders.begin(), flattened->appenders.end(), *it) == flattened->appenders.end())
+				flattened->appenders.push_back(*it);
+		}
+
+		if(!c->_additivity)
+			break;
+	}
+
+	vector<unsigned int> shareIds;
+	for(SharedAppenderPtrList::const_iterator it = flattened->appenders.begin(); it != flattened->appenders.end(); ++it)
+	{
+		unsigned int const shareId = (*it)->getLayoutShareId();
+		if(shareId == 0)
+			continue;
+		if(std::find(shareIds.begin(), shareIds.end(), shareId) != shareIds.end())
+		{
+			flattened->shareFormatting = true;
+			break;
+		}
+		shareIds.push_back(shareId);
+	}
+
+	if(current)
+		_retiredAppenders.push_back(current);
+	atomicCompareExchangePointer(&_flattenedAppenders, current, flattened.get());
+
+	// Once only this thread is dispatching, every other one that comes
+	// along reads the new list, so the retired ones can go.
+	if(atomicCompareExchange(&_dispatching, 1, 1) == 1)
+	{
+		for(vector<FlattenedAppenders*>::iterator it = _retiredAppenders.begin(); it != _retiredAppenders.end(); ++it)
+			delete *it;
+		_retiredAppenders.clear();
+	}
+
+	return flattened.release();
+}
+
+
+void LoggerImpl::setAdditivity(bool additivity)
+{
+	_additivity = additivity;
+	notifyChange();
+}
+
+
 void LoggerImpl::closeNestedAppenders()
 {
 	SharedAppenderPtrList appenders = getAllAppenders();
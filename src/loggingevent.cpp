@@ -3,7 +3,10 @@
 
 
 #include "log4cplus/loggingevent.h"
+#include "log4cplus/stringhelper.h"
+#include "log4cplus/environment.h"
 #include <algorithm>
+#include <cstdio>
 
 using namespace std;
 using namespace log4cplus;
@@ -18,26 +21,50 @@ InternalLoggingEvent::InternalLoggingEvent(const string& logger,
 	, _loggerName(logger)
 	, _ll(loglevel)
 	, _timestamp(TimeHelper::gettimeofday())
+	, _location(NULL)
+	, _fieldCount(0)
+	, _sharedFormatCount(0)
+	, _isSharingFormats(false)
 {
+	refreshThread();
 }
 
 InternalLoggingEvent::InternalLoggingEvent(const string& logger,
 	LogLevel loglevel, const string& message_, TimeHelper time)
 	: _message(message_), _loggerName(logger)
 	, _ll(loglevel), _timestamp(time)
+	, _location(NULL)
+	, _fieldCount(0)
+	, _sharedFormatCount(0)
+	, _isSharingFormats(false)
 {
+	refreshThread();
 }
 
 InternalLoggingEvent::InternalLoggingEvent()
 	: _ll(NOT_SET_LOG_LEVEL)
-{}
+	, _location(NULL)
+	, _fieldCount(0)
+	, _sharedFormatCount(0)
+	, _isSharingFormats(false)
+{
+	refreshThread();
+}
 
 InternalLoggingEvent::InternalLoggingEvent(const InternalLoggingEvent& rhs)
 	: _message(rhs.getMessage())
 	, _loggerName(rhs.getLoggerName())
 	, _ll(rhs.getLogLevel())
 	, _timestamp(rhs.getTimestamp())
+	, _location(rhs._location)
+	, _thread(rhs._thread)
+	, _threadName(rhs._threadName)
+	, _fieldCount(rhs._fieldCount)
+	, _context(rhs._context)
+	, _sharedFormatCount(0)
+	, _isSharingFormats(false)
 {
+	std::copy(rhs._fields, rhs._fields + rhs._fieldCount, _fields);
 }
 
 InternalLoggingEvent::~InternalLoggingEvent()
@@ -54,7 +81,8 @@ unsigned int InternalLoggingEvent::getDefaultType()
 }
 
 
-void InternalLoggingEvent::setLoggingEvent(const string& logger, LogLevel loglevel, const string& msg)
+void InternalLoggingEvent::setLoggingEvent(const string& logger, LogLevel loglevel, const string& msg,
+	const LogLocation* location)
 {
 	// This could be imlemented using the swap idiom:
 	//
@@ -67,8 +95,102 @@ void InternalLoggingEvent::setLoggingEvent(const string& logger, LogLevel loglev
 	_ll = loglevel;
 	_message = msg;
 	_timestamp = TimeHelper::gettimeofday();
+	_location = location;
+	_fieldCount = 0;
+}
+
+
+void InternalLoggingEvent::refreshThread()
+{
+	_thread.clear();
+	appendUnsignedToString(_thread, getThreadId());
+}
+
+
+void log4cplus::setThreadName(const string& name)
+{
+	getInternalLoggingEvent()->setThreadName(name);
+}
+
+
+LogField* InternalLoggingEvent::nextField(const char* key, LogField::Type type)
+{
+	if(_fieldCount == MAX_FIELDS)
+		return NULL;
+
+	LogField* field = &_fields[_fieldCount++];
+	field->_key = key;
+	field->_type = type;
+	return field;
+}
+
+
+void InternalLoggingEvent::addField(const char* key, long long value)
+{
+	if(LogField* field = nextField(key, LogField::INTEGER_FIELD))
+		field->_value.i = value;
+}
+
+
+void InternalLoggingEvent::addField(const char* key, unsigned long long value)
+{
+	if(LogField* field = nextField(key, LogField::UNSIGNED_FIELD))
+		field->_value.u = value;
+}
+
+
+void InternalLoggingEvent::addField(const char* key, double value)
+{
+	if(LogField* field = nextField(key, LogField::DOUBLE_FIELD))
+		field->_value.d = value;
+}
+
+
+void InternalLoggingEvent::addField(const char* key, bool value)
+{
+	if(LogField* field = nextField(key, LogField::BOOL_FIELD))
+		field->_value.b = value;
+}
+
+
+void InternalLoggingEvent::addField(const char* key, const char* value)
+{
+	if(LogField* field = nextField(key, LogField::STRING_FIELD))
+		field->_text = value ? value : "";
 }
 
+
+void InternalLoggingEvent::addField(const char* key, const string& value)
+{
+	if(LogField* field = nextField(key, LogField::STRING_FIELD))
+		field->_text = value;
+}
+
+string* InternalLoggingEvent::getSharedFormat(unsigned int shareId, bool& isNew) const
+{
+	if(!_isSharingFormats)
+		return NULL;
+
+	for(size_t i = 0; i < _sharedFormatCount; ++i)
+	{
+		if(_sharedFormats[i].shareId == shareId)
+		{
+			isNew = false;
+			return &_sharedFormats[i].text;
+		}
+	}
+
+	if(_sharedFormatCount == _sharedFormats.size())
+		_sharedFormats.resize(_sharedFormatCount + 1);
+
+	SharedFormat& format = _sharedFormats[_sharedFormatCount++];
+	format.shareId = shareId;
+	format.text.clear();
+	isNew = true;
+	return &format.text;
+}
+
+
 const string& InternalLoggingEvent::getMessage() const
 {
 	return _message;
@@ -100,5 +222,69 @@ void InternalLoggingEvent::swap(InternalLoggingEvent & other)
 	swap(_loggerName, other._loggerName);
 	swap(_ll, other._ll);
 	swap(_timestamp, other._timestamp);
+	swap(_location, other._location);
+	swap(_thread, other._thread);
+	swap(_threadName, other._threadName);
+	std::swap_ranges(_fields, _fields + std::max(_fieldCount, other._fieldCount), other._fields);
+	swap(_fieldCount, other._fieldCount);
+	_context.swap(other._context);
+}
+
+
+const char* LogLocation::getBasename() const
+{
+	// Threads racing here store the same pointer.
+	const char* name = basename;
+	if(!name)
+	{
+		name = file;
+		for(const char* p = file; *p; ++p)
+		{
+#ifdef _MSC_VER
+			if(*p == '\\' || *p == '/')
+#else
+			if(*p == '/')
+#endif
+				name = p + 1;
+		}
+		basename = name;
+	}
+	return name;
+}
+
+
+void LogField::appendValue(string& result) const
+{
+	switch(_type)
+	{
+	case INTEGER_FIELD:
+		appendIntegerToString(result, _value.i);
+		break;
+
+	case UNSIGNED_FIELD:
+		appendUnsignedToString(result, _value.u);
+		break;
+
+	case DOUBLE_FIELD:
+		{
+			char buffer[32];
+#ifdef _MSC_VER
+			int const length = sprintf_s(buffer, sizeof(buffer), "%.15g", _value.d);
+#else
+			int const length = snprintf(buffer, sizeof(buffer), "%.15g", _value.d);
+#endif
+			if(length > 0)
+				result.append(buffer, std::min<size_t>(length, sizeof(buffer) - 1));
+		}
+		break;
+
+	case BOOL_FIELD:
+		result += _value.b ? "true" : "false";
+		break;
+
+	case STRING_FIELD:
+		result += _text;
+		break;
+	}
 }
 
@@ -9,10 +9,19 @@ using namespace std;
 using namespace log4cplus;
 
 
-void log4cplus::macro_forcedLog(Logger const& logger, LogLevel logLevel, string const& msg)
+void log4cplus::macro_forcedLog(Logger const& logger, LogLevel logLevel, string const& msg,
+	LogLocation const* location)
 {
 	InternalLoggingEvent& loggingEvent = *getInternalLoggingEvent();
-	loggingEvent.setLoggingEvent(logger.getName(), logLevel, msg);
+	loggingEvent.setLoggingEvent(logger.getName(), logLevel, msg, location);
 	logger.forcedLog(loggingEvent);
 }
 
+
+InternalLoggingEvent& log4cplus::macro_prepareEvent(Logger const& logger, LogLevel logLevel, string const& msg,
+	LogLocation const* location)
+{
+	InternalLoggingEvent& loggingEvent = *getInternalLoggingEvent();
+	loggingEvent.setLoggingEvent(logger.getName(), logLevel, msg, location);
+	return loggingEvent;
+}
@@ -26,7 +26,7 @@ LogLog* LogLog::getLogLog()
 }
 
 
-LogLog::LogLog() : _isDebugEnabled(false) {}
+LogLog::LogLog() : _isDebugEnabled(false), _mutex("LogLog") {}
 
 LogLog::~LogLog() {}
 
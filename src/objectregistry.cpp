@@ -8,7 +8,7 @@ using namespace std;
 using namespace log4cplus;
 
 
-ObjectRegistryBase::ObjectRegistryBase() {}
+ObjectRegistryBase::ObjectRegistryBase() : _mutex("ObjectRegistry") {}
 
 ObjectRegistryBase::~ObjectRegistryBase() {}
 
@@ -3,6 +3,9 @@
 
 #include <sstream>
 #include <cstdlib>
+#include <ctime>
+#include <typeinfo>
+#include <algorithm>
 
 #include "log4cplus/layout.h"
 #include "log4cplus/loglog.h"
@@ -11,6 +14,7 @@
 #include "log4cplus/property.h"
 #include "log4cplus/loggingevent.h"
 #include "log4cplus/environment.h"
+#include "log4cplus/atomic.h"
 
 
 using namespace std;
@@ -51,7 +55,7 @@ namespace log4cplus
 	public:
 		explicit PatternConverter(const FormattingInfo& info);
 		virtual ~PatternConverter() {}
-		void formatAndAppend(ostream& output, 
+		void formatAndAppend(ByteSink& output,
 			const InternalLoggingEvent& loggingEvent);
 
 		virtual void convert(string& result,
@@ -61,6 +65,7 @@ namespace log4cplus
 		int _minLen;
 		std::size_t _maxLen;
 		bool _leftAlign;
+		std::string _converted;		// reused by every event
 	};
 }
 
@@ -69,9 +74,6 @@ typedef vector<PatternConverter*> PatternConverterList;
 
 static char const ESCAPE_CHAR = '%';
 
-extern void formatRelativeTimestamp(ostream & output, log4cplus::InternalLoggingEvent const& loggingEvent);
-
-
 
 /**
 * This PatternConverter returns a constant string.
@@ -86,6 +88,9 @@ public:
 		result = str;
 	}
 
+	const string& getLiteral() const { return str; }
+	void appendLiteral(const string& more) { str += more; }
+
 private:
 	string str;
 };
@@ -104,6 +109,14 @@ public:
 		LOGLEVEL_CONVERTER,
 		MESSAGE_CONVERTER,
 		NEWLINE_CONVERTER,
+		NDC_CONVERTER,
+		THREAD_CONVERTER,
+		THREAD_NAME_CONVERTER,
+		FILE_CONVERTER,
+		BASENAME_CONVERTER,
+		LINE_CONVERTER,
+		FUNCTION_CONVERTER,
+		FULL_LOCATION_CONVERTER,
 	};
 	BasicPatternConverter(const FormattingInfo& info, PatternConverterType type);
 	virtual void convert(string& result, const InternalLoggingEvent& loggingEvent);
@@ -115,6 +128,8 @@ private:
 
 	LogLevelManager& _llmCache;
 	PatternConverterType _ConverterType;
+	int _cachedProcessId;
+	string _cachedProcessIdString;
 };
 
 
@@ -156,11 +171,48 @@ private:
 class EnvPatternConverter : public PatternConverter
 {
 public:
-	EnvPatternConverter(const FormattingInfo& info, const string& env);
+	EnvPatternConverter(const FormattingInfo& info, const string& env, int refreshInterval);
 	virtual void convert(string& result, const InternalLoggingEvent& loggingEvent);
 
 private:
+	void refresh(time_t now);
+
 	string _envKey;
+	string _value;
+	int _refreshInterval;
+	time_t _nextRefresh;
+	AtomicInt _generation;
+};
+
+
+/**
+* This PatternConverter is used to format the key/value fields of the
+* event, either all of them as <code>key=value</code> pairs or the value
+* of a single key.
+*/
+class FieldsPatternConverter : public PatternConverter
+{
+public:
+	FieldsPatternConverter(const FormattingInfo& info, const string& key);
+	virtual void convert(string& result, const InternalLoggingEvent& loggingEvent);
+
+private:
+	string _key;
+};
+
+
+/**
+* This PatternConverter is used to format the MDC, either the value of
+* one key or all entries as <code>key=value</code> pairs.
+*/
+class MDCPatternConverter : public PatternConverter
+{
+public:
+	MDCPatternConverter(const FormattingInfo& info, const string& key);
+	virtual void convert(string& result, const InternalLoggingEvent& loggingEvent);
+
+private:
+	string _key;
 };
 
 
@@ -173,7 +225,7 @@ private:
 class PatternParser
 {
 public:
-	PatternParser(const string& pattern);
+	PatternParser(const string& pattern, int envRefreshInterval);
 	vector<PatternConverter*> parse();
 
 private:
@@ -191,6 +243,8 @@ private:
 	string extractOption();
 	int extractPrecisionOption();
 	void finalizeConverter(char c);
+	PatternConverter* makeConstant(const string& value) const;
+	void mergeLiterals();
 
 	// Data
 	string _patternString;
@@ -199,6 +253,7 @@ private:
 	ParserState _parserState;
 	string::size_type _pos;
 	string _currentLiteral;
+	int _envRefreshInterval;
 };
 
 
@@ -213,27 +268,28 @@ PatternConverter::PatternConverter(const FormattingInfo& info)
 }
 
 
-void PatternConverter::formatAndAppend(ostream& output, const InternalLoggingEvent& loggingEvent)
+void PatternConverter::formatAndAppend(ByteSink& output, const InternalLoggingEvent& loggingEvent)
 {
-	string str;
-	convert(str, loggingEvent);
-	std::size_t len = str.length();
+	convert(_converted, loggingEvent);
+	std::size_t len = _converted.length();
 
 	if(len > _maxLen)
-		output << str.substr(len - _maxLen);
+		output.append(_converted.data() + len - _maxLen, _maxLen);
 	else if(static_cast<int>(len) < _minLen)
 	{
-		std::ios_base::fmtflags const original_flags = output.flags();
-		char const fill = output.fill(' ');
-		output.setf(_leftAlign ? std::ios_base::left : std::ios_base::right,
-			std::ios_base::adjustfield);
-		output.width(_minLen);
-		output << str;
-		output.fill(fill);
-		output.flags(original_flags);
+		std::size_t const padding = _minLen - len;
+		if(_leftAlign)
+			output.append(_converted);
+
+		char* const room = output.reserve(padding);
+		std::fill(room, room + padding, ' ');
+		output.commit(padding);
+
+		if(!_leftAlign)
+			output.append(_converted);
 	}
 	else
-		output << str;
+		output.append(_converted);
 }
 
 
@@ -253,7 +309,7 @@ LiteralPatternConverter::LiteralPatternConverter(const string& str_)
 ////////////////////////////////////////////////
 
 BasicPatternConverter::BasicPatternConverter(const FormattingInfo& info, PatternConverterType type_)
-	: PatternConverter(info), _llmCache(getLogLevelManager()), _ConverterType(type_)
+	: PatternConverter(info), _llmCache(getLogLevelManager()), _ConverterType(type_), _cachedProcessId(0)
 {
 }
 
@@ -269,15 +325,64 @@ void BasicPatternConverter::convert(string& result,
 		return;
 
 	case PROCESS_CONVERTER:
-		{		
-			int pid = 0; 
-#ifdef _MSC_VER 
-			pid = (int)GetCurrentProcessId();
-#else
-			pid = (int)getpid();
-#endif
-
-			convertIntegerToString(result, pid); 
+		{
+			// getProcessId() is cached and changes only after fork().
+			int const pid = getProcessId();
+			if(pid != _cachedProcessId)
+			{
+				convertIntegerToString(_cachedProcessIdString, pid);
+				_cachedProcessId = pid;
+			}
+			result = _cachedProcessIdString;
+		}
+		return;
+
+	case THREAD_CONVERTER:
+		result = loggingEvent.getThread();
+		return;
+
+	case THREAD_NAME_CONVERTER:
+		result = loggingEvent.getThreadName();
+		return;
+
+	case FILE_CONVERTER:
+	case BASENAME_CONVERTER:
+	case LINE_CONVERTER:
+	case FUNCTION_CONVERTER:
+	case FULL_LOCATION_CONVERTER:
+		{
+			// Events logged without the macros have no location.
+			LogLocation const* location = loggingEvent.getLocation();
+			if(!location)
+			{
+				result.clear();
+				return;
+			}
+
+			switch(_ConverterType)
+			{
+			case FILE_CONVERTER:
+				result = location->file;
+				break;
+
+			case BASENAME_CONVERTER:
+				result = location->getBasename();
+				break;
+
+			case LINE_CONVERTER:
+				convertIntegerToString(result, location->line);
+				break;
+
+			case FUNCTION_CONVERTER:
+				result = location->function;
+				break;
+
+			default:
+				result = location->file;
+				result += ':';
+				appendIntegerToString(result, location->line);
+				break;
+			}
 		}
 		return;
 
@@ -288,6 +393,11 @@ void BasicPatternConverter::convert(string& result,
 	case NEWLINE_CONVERTER:
 		result = "\n";
 		return; 
+
+	case NDC_CONVERTER:
+		result.clear();
+		loggingEvent.getDiagnosticContext().appendNested(result);
+		return;
 	}
 
 	result = "INTERNAL LOG4CPLUS ERROR";
@@ -352,17 +462,122 @@ void DatePatternConverter::convert(string& result, const InternalLoggingEvent& l
 ////////////////////////////////////////////////
 // EnvPatternConverter methods:
 ////////////////////////////////////////////////
-EnvPatternConverter::EnvPatternConverter(const FormattingInfo& info, const string& env)
-	: PatternConverter(info), _envKey(env)
+
+// Bumped by PatternLayout::refreshEnvironment().
+static volatile AtomicInt s_environmentGeneration;
+
+
+EnvPatternConverter::EnvPatternConverter(const FormattingInfo& info, const string& env, int refreshInterval)
+	: PatternConverter(info), _envKey(env), _refreshInterval(refreshInterval), _nextRefresh(0)
+	, _generation(s_environmentGeneration)
+{
+	refresh(time(NULL));
+}
+
+
+void EnvPatternConverter::refresh(time_t now)
+{
+	if(!getEnvString(_value, _envKey))
+	{
+		// Variable doesn't exist, use empty string.
+		_value.clear();
+	}
+
+	if(_refreshInterval > 0)
+		_nextRefresh = now + _refreshInterval;
+}
+
+
+void EnvPatternConverter::convert(string& result, const InternalLoggingEvent& loggingEvent)
+{
+	AtomicInt const generation = s_environmentGeneration;
+	if(generation != _generation)
+	{
+		_generation = generation;
+		refresh(loggingEvent.getTimestamp().sec());
+	}
+	else if(_refreshInterval > 0 && loggingEvent.getTimestamp().sec() >= _nextRefresh)
+		refresh(loggingEvent.getTimestamp().sec());
+
+	result = _value;
+}
+
+
+////////////////////////////////////////////////
+// FieldsPatternConverter methods:
+////////////////////////////////////////////////
+FieldsPatternConverter::FieldsPatternConverter(const FormattingInfo& info, const string& key)
+	: PatternConverter(info), _key(key)
+{}
+
+
+// Values that would be ambiguous in key=value pairs are quoted.
+static bool needsQuotes(const string& value)
+{
+	return value.empty() || value.find_first_of(" \"=\t\r\n") != string::npos;
+}
+
+
+void FieldsPatternConverter::convert(string& result, const InternalLoggingEvent& loggingEvent)
+{
+	result.clear();
+	unsigned int const count = loggingEvent.getFieldCount();
+	for(unsigned int i = 0; i < count; ++i)
+	{
+		const LogField& field = loggingEvent.getField(i);
+		if(!_key.empty())
+		{
+			if(field.getKey() == _key)
+			{
+				field.appendValue(result);
+				return;
+			}
+			continue;
+		}
+
+		if(!result.empty())
+			result += ' ';
+		result += field.getKey();
+		result += '=';
+		if(field.getType() == LogField::STRING_FIELD && needsQuotes(field.getString()))
+		{
+			const string& value = field.getString();
+			result += '"';
+			appendJsonEscaped(result, value.data(), value.size());
+			result += '"';
+		}
+		else
+			field.appendValue(result);
+	}
+}
+
+
+////////////////////////////////////////////////
+// MDCPatternConverter methods:
+////////////////////////////////////////////////
+MDCPatternConverter::MDCPatternConverter(const FormattingInfo& info, const string& key)
+	: PatternConverter(info), _key(key)
 {}
 
 
-void EnvPatternConverter::convert(string& result, const InternalLoggingEvent&)
+void MDCPatternConverter::convert(string& result, const InternalLoggingEvent& loggingEvent)
 {
-	if(!getEnvString(result, _envKey))
+	const DiagnosticContext& context = loggingEvent.getDiagnosticContext();
+	result.clear();
+	if(!_key.empty())
 	{
-		// Variable doesn't exist, return empty string.
-		result.clear();
+		if(const string* value = context.get(_key))
+			result = *value;
+		return;
+	}
+
+	for(size_t i = 0; i < context.getMappedCount(); ++i)
+	{
+		if(i > 0)
+			result += ' ';
+		result += context.getMappedKey(i);
+		result += '=';
+		result += context.getMappedValue(i);
 	}
 }
 
@@ -371,8 +586,9 @@ void EnvPatternConverter::convert(string& result, const InternalLoggingEvent&)
 // PatternParser methods:
 ////////////////////////////////////////////////
 
-PatternParser::PatternParser(const string& pattern_)
+PatternParser::PatternParser(const string& pattern_, int envRefreshInterval)
 	: _patternString(pattern_), _parserState(LITERAL_STATE), _pos(0)
+	, _envRefreshInterval(envRefreshInterval)
 {
 }
 
@@ -527,19 +743,62 @@ PatternConverterList PatternParser::parse()
 		_patternConverterlist.push_back(new LiteralPatternConverter(_currentLiteral));
 	}
 
+	mergeLiterals();
 	return _patternConverterlist;
 }
 
 
+/**
+* Values that cannot change while the process runs are formatted once,
+* here, and become part of the literal text of the pattern.
+*/
+PatternConverter* PatternParser::makeConstant(const string& value) const
+{
+	string formatted(value);
+	size_t const len = value.length();
+	if(len > _formattingInfo.maxLen)
+		formatted = value.substr(len - _formattingInfo.maxLen);
+	else if(static_cast<int>(len) < _formattingInfo.minLen)
+	{
+		string const padding(_formattingInfo.minLen - len, ' ');
+		formatted = _formattingInfo.leftAlign ? value + padding : padding + value;
+	}
+
+	return new LiteralPatternConverter(formatted);
+}
+
+
+void PatternParser::mergeLiterals()
+{
+	PatternConverterList merged;
+	LiteralPatternConverter* previous = 0;
+	for(PatternConverterList::iterator it = _patternConverterlist.begin(); it != _patternConverterlist.end(); ++it)
+	{
+		LiteralPatternConverter* literal = dynamic_cast<LiteralPatternConverter*>(*it);
+		if(literal && previous)
+		{
+			previous->appendLiteral(literal->getLiteral());
+			delete literal;
+			continue;
+		}
+
+		previous = literal;
+		merged.push_back(*it);
+	}
+
+	_patternConverterlist.swap(merged);
+}
+
+
 
 void PatternParser::finalizeConverter(char c) 
 {
 	PatternConverter* pc = 0;
 	switch(c) 
 	{
-// 	case 'b':
-// 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::BASENAME_CONVERTER);      
-// 		break;
+	case 'b':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::BASENAME_CONVERTER);      
+		break;
 
 	case 'c':
 		pc = new LoggerPatternConverter(_formattingInfo, extractPrecisionOption());   
@@ -558,32 +817,50 @@ void PatternParser::finalizeConverter(char c)
 		break;
 
 	case 'E':
-		pc = new EnvPatternConverter(_formattingInfo, extractOption());     
+		pc = new EnvPatternConverter(_formattingInfo, extractOption(), _envRefreshInterval);     
 		break;
 
-// 	case 'F':
-// 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::FILE_CONVERTER);     
-// 		break;
+	case 'e':
+		pc = makeConstant(getExecutableName());
+		break;
+
+	case 'h':
+		pc = makeConstant(getHostName());
+		break;
+
+	case 'F':
+		{
+			// %F{basename} is the same as %b.
+			string const fOpt = extractOption();
+			pc = new BasicPatternConverter(_formattingInfo, fOpt == "basename"
+				? BasicPatternConverter::BASENAME_CONVERTER : BasicPatternConverter::FILE_CONVERTER);
+		}
+		break;
 
 	case 'i':
+		// Not a constant: the process id changes in a forked child.
 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::PROCESS_CONVERTER);   
 		break;
 
-// 	case 'l':
-// 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::FULL_LOCATION_CONVERTER);  
-// 		break;
-// 
-// 	case 'L':
-// 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::LINE_CONVERTER);   
-// 		break;
+	case 'K':
+		pc = new FieldsPatternConverter(_formattingInfo, extractOption());
+		break;
+
+	case 'l':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::FULL_LOCATION_CONVERTER);  
+		break;
+
+	case 'L':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::LINE_CONVERTER);   
+		break;
 
 	case 'm':
 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::MESSAGE_CONVERTER);    
 		break;
 
-// 	case 'M':
-// 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::FUNCTION_CONVERTER);  
-// 		break;
+	case 'M':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::FUNCTION_CONVERTER);  
+		break;
 
 	case 'n':
 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::NEWLINE_CONVERTER);     
@@ -593,6 +870,22 @@ void PatternParser::finalizeConverter(char c)
 		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::LOGLEVEL_CONVERTER);
 		break;
 
+	case 't':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::THREAD_CONVERTER);
+		break;
+
+	case 'T':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::THREAD_NAME_CONVERTER);
+		break;
+
+	case 'x':
+		pc = new BasicPatternConverter(_formattingInfo, BasicPatternConverter::NDC_CONVERTER);
+		break;
+
+	case 'X':
+		pc = new MDCPatternConverter(_formattingInfo, extractOption());
+		break;
+
 	default:
 		ostringstream buf;
 		buf << "Unexpected char [" << c
@@ -620,7 +913,7 @@ PatternLayout::PatternLayout(const string& pattern_)
 	init(pattern_);
 }
 
-PatternLayout::PatternLayout(const Properties& properties)
+PatternLayout::PatternLayout(const Properties& properties) : Layout(properties), _envRefreshInterval(0)
 {
 	bool isHasPattern = properties.exists("Pattern");
 	bool isHasConversionPattern = properties.exists("ConversionPattern");
@@ -631,13 +924,16 @@ PatternLayout::PatternLayout(const Properties& properties)
 			" deprecated.  Use ConversionPattern instead.");
 	}
 
+	int envRefreshInterval = 0;
+	properties.getInt(envRefreshInterval, "EnvRefreshInterval");
+
 	if(isHasConversionPattern) 
 	{
-		init(properties.getProperty("ConversionPattern"));
+		init(properties.getProperty("ConversionPattern"), envRefreshInterval);
 	}
 	else if(isHasPattern) 
 	{
-		init(properties.getProperty("Pattern"));
+		init(properties.getProperty("Pattern"), envRefreshInterval);
 	}
 	else
 	{
@@ -646,10 +942,11 @@ PatternLayout::PatternLayout(const Properties& properties)
 
 }
 
-void PatternLayout::init(const string& pattern_)
+void PatternLayout::init(const string& pattern_, int envRefreshInterval)
 {
 	_pattern = pattern_;
-	_parsedPattern = PatternParser(_pattern).parse();
+	_envRefreshInterval = envRefreshInterval;
+	_parsedPattern = PatternParser(_pattern, envRefreshInterval).parse();
 
 	// Let's validate that our parser didn't give us any NULLs.  If it did,
 	// we will convert them to a valid PatternConverter that does nothing so
@@ -678,11 +975,49 @@ PatternLayout::~PatternLayout()
 	}
 }
 
+void PatternLayout::refreshEnvironment()
+{
+	atomicIncrement(&s_environmentGeneration);
+}
+
+
 void PatternLayout::formatAndAppend(ostream& output, const InternalLoggingEvent& loggingEvent)
+{
+	OStreamByteSink sink(output);
+	format(sink, loggingEvent);
+}
+
+
+void PatternLayout::format(ByteSink& sink, const InternalLoggingEvent& loggingEvent)
 {
 	for(PatternConverterList::iterator it=_parsedPattern.begin(); it!=_parsedPattern.end(); ++it)
 	{
-		(*it)->formatAndAppend(output, loggingEvent);
+		(*it)->formatAndAppend(sink, loggingEvent);
 	}
 }
 
+
+std::auto_ptr<Layout> PatternLayout::clone() const
+{
+	// A derived layout would be copied as a plain PatternLayout.
+	if(typeid(*this) != typeid(PatternLayout))
+		return std::auto_ptr<Layout>();
+
+	Properties properties;
+	properties.setProperty("ConversionPattern", _pattern);
+	properties.setProperty("EnvRefreshInterval", convertIntegerToString(_envRefreshInterval));
+	return std::auto_ptr<Layout>(new PatternLayout(properties));
+}
+
+
+string PatternLayout::getFormatKey() const
+{
+	// Layouts refreshing %E on other intervals may show other values.
+	string key(typeid(*this).name());
+	key += ':';
+	appendIntegerToString(key, _envRefreshInterval);
+	key += ':';
+	key += _pattern;
+	return key;
+}
+
@@ -0,0 +1,354 @@
+// Module:  Log4CPLUS
+// File:    retention.cpp
+
+#include "log4cplus/retention.h"
+#include "log4cplus/loglog.h"
+#include "log4cplus/timehelper.h"
+#include "log4cplus/environment.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+//! Directory entries read per step of a scan.
+static int const SCAN_STEP_ENTRIES = 256;
+//! How often the ages of the files are checked.
+static unsigned long const AGE_CHECK_MILLIS = 60000;
+
+
+static bool isFamilyMember(const string& baseName, const string& name)
+{
+	return name.size() > baseName.size() + 1
+		&& name.compare(0, baseName.size(), baseName) == 0
+		&& name[baseName.size()] == '.';
+}
+
+
+static bool statFile(const string& path, long long& size, time_t& mtime, long& mtimeNanos)
+{
+#ifdef _MSC_VER
+	struct _stati64 info;
+	if(_stati64(path.c_str(), &info) != 0 || !(info.st_mode & _S_IFREG))
+		return false;
+#else
+	struct stat info;
+	if(stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+		return false;
+#endif
+
+	size = info.st_size;
+	mtime = info.st_mtime;
+#ifdef _MSC_VER
+	mtimeNanos = 0;
+#else
+	mtimeNanos = info.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+
+//! The number a rollover appended to a name, e.g. 3 for app.log.3.
+static long getRolloverIndex(const string& name)
+{
+	string::size_type const dot = name.find_last_of('.');
+	if(dot == string::npos || dot + 1 == name.size()
+		|| name.find_first_not_of("0123456789", dot + 1) != string::npos)
+	{
+		return 0;
+	}
+
+	return atol(name.c_str() + dot + 1);
+}
+
+
+namespace
+{
+	//! A rolled file, ordered oldest first. Files written within the
+	//! same mtime tick are ordered by their rollover index, as higher
+	//! indices hold older events.
+	struct AgedFile
+	{
+		time_t mtime;
+		long mtimeNanos;
+		long index;
+		string name;
+
+		bool operator< (const AgedFile& other) const
+		{
+			if(mtime != other.mtime)
+				return mtime < other.mtime;
+			if(mtimeNanos != other.mtimeNanos)
+				return mtimeNanos < other.mtimeNanos;
+			if(index != other.index)
+				return index > other.index;
+			return name < other.name;
+		}
+	};
+}
+
+
+RetentionManager& RetentionManager::getInstance()
+{
+	static RetentionManager instance;
+	return instance;
+}
+
+
+static Mutex& getLifecycleMutex()
+{
+	static Mutex lifecycleMutex("RetentionManager::lifecycle");
+	return lifecycleMutex;
+}
+
+
+RetentionManager::RetentionManager()
+	: _mutex("RetentionManager::_mutex")
+	, _nextId(1)
+	, _stopping(0)
+{
+}
+
+
+RetentionManager::~RetentionManager()
+{
+	stop();
+
+	for(Families::iterator it = _families.begin(); it != _families.end(); ++it)
+		delete it->second.scan;
+}
+
+
+unsigned int RetentionManager::addFamily(const string& filename, long long maxTotalSize, unsigned int maxAgeDays)
+{
+	MutexLock lifecycleLock(&getLifecycleMutex());
+
+	unsigned int id;
+	{
+		MutexLock lock(&_mutex);
+
+		id = _nextId++;
+		Family& family = _families[id];
+		splitDirectory(family.directory, family.baseName, filename);
+		family.maxTotalSize = maxTotalSize;
+		family.maxAgeDays = maxAgeDays;
+		family.scan = new DirectoryScan(family.directory);
+		family.isChanged = false;
+	}
+
+	if(!isStarted())
+	{
+		atomicExchange(&_stopping, 0);
+		if(!start())
+			LogLog::getLogLog()->error("RetentionManager- Unable to start the retention thread");
+	}
+
+	_wakeup.signal();
+	return id;
+}
+
+
+void RetentionManager::removeFamily(unsigned int id)
+{
+	MutexLock lifecycleLock(&getLifecycleMutex());
+
+	bool isEmpty;
+	{
+		MutexLock lock(&_mutex);
+
+		Families::iterator const it = _families.find(id);
+		if(it == _families.end())
+			return;
+
+		delete it->second.scan;
+		_families.erase(it);
+		isEmpty = _families.empty();
+	}
+
+	if(isEmpty)
+		stop();
+}
+
+
+void RetentionManager::rolled(unsigned int id, const vector<string>& paths)
+{
+	{
+		MutexLock lock(&_mutex);
+
+		Families::iterator const it = _families.find(id);
+		if(it == _families.end())
+			return;
+
+		Family& family = it->second;
+		family.reported.insert(family.reported.end(), paths.begin(), paths.end());
+		family.isChanged = true;
+	}
+
+	_wakeup.signal();
+}
+
+
+void RetentionManager::stop()
+{
+	if(!isStarted())
+		return;
+
+	atomicExchange(&_stopping, 1);
+	_wakeup.signal();
+	join();
+}
+
+
+void RetentionManager::run()
+{
+	TimeHelper nextAgeCheck = TimeHelper::gettimeofday() + TimeHelper(AGE_CHECK_MILLIS / 1000);
+	bool hasWork = true;
+
+	for(;;)
+	{
+		if(!hasWork)
+			_wakeup.timedWait(AGE_CHECK_MILLIS);
+		if(_stopping != 0)
+			break;
+
+		TimeHelper const now = TimeHelper::gettimeofday();
+		bool const isAgeCheckDue = now >= nextAgeCheck;
+		if(isAgeCheckDue)
+			nextAgeCheck = now + TimeHelper(AGE_CHECK_MILLIS / 1000);
+
+		hasWork = processStep(isAgeCheckDue);
+	}
+}
+
+
+bool RetentionManager::processStep(bool isAgeCheckDue)
+{
+	MutexLock lock(&_mutex);
+
+	// Families reported from here on are looked at by the next step.
+	_wakeup.reset();
+
+	bool hasWork = false;
+	for(Families::iterator it = _families.begin(); it != _families.end(); ++it)
+	{
+		Family& family = it->second;
+		if(family.scan)
+		{
+			hasWork = scanStep(family) || hasWork;
+		}
+		else if(family.isChanged)
+		{
+			restat(family);
+			enforce(family);
+			family.isChanged = false;
+		}
+		else if(isAgeCheckDue)
+		{
+			enforce(family);
+		}
+	}
+
+	return hasWork;
+}
+
+
+bool RetentionManager::scanStep(Family& family)
+{
+	string name;
+	for(int i = 0; i < SCAN_STEP_ENTRIES; ++i)
+	{
+		if(!family.scan->next(name))
+		{
+			delete family.scan;
+			family.scan = NULL;
+			family.isChanged = true;
+			break;
+		}
+
+		FileEntry entry;
+		if(isFamilyMember(family.baseName, name)
+			&& statFile(family.directory + "/" + name, entry.size, entry.mtime, entry.mtimeNanos))
+		{
+			family.files[name] = entry;
+		}
+	}
+
+	return true;
+}
+
+
+void RetentionManager::restat(Family& family)
+{
+	string directory;
+	string name;
+	for(vector<string>::const_iterator it = family.reported.begin(); it != family.reported.end(); ++it)
+	{
+		splitDirectory(directory, name, *it);
+		if(isFamilyMember(family.baseName, name))
+			family.files[name];
+	}
+	family.reported.clear();
+
+	// Rollovers rename the files, so the known names are looked at too.
+	map<string, FileEntry>::iterator it = family.files.begin();
+	while(it != family.files.end())
+	{
+		FileEntry& entry = it->second;
+		if(statFile(family.directory + "/" + it->first, entry.size, entry.mtime, entry.mtimeNanos))
+			++it;
+		else
+			family.files.erase(it++);
+	}
+}
+
+
+void RetentionManager::enforce(Family& family)
+{
+	if(family.maxTotalSize <= 0 && family.maxAgeDays == 0)
+		return;
+
+	long long total = 0;
+	vector<AgedFile> byAge;
+	for(map<string, FileEntry>::const_iterator it = family.files.begin(); it != family.files.end(); ++it)
+	{
+		total += it->second.size;
+
+		AgedFile file;
+		file.mtime = it->second.mtime;
+		file.mtimeNanos = it->second.mtimeNanos;
+		file.index = getRolloverIndex(it->first);
+		file.name = it->first;
+		byAge.push_back(file);
+	}
+	sort(byAge.begin(), byAge.end());
+
+	FileEntry active;
+	if(statFile(family.directory + "/" + family.baseName, active.size, active.mtime, active.mtimeNanos))
+		total += active.size;
+
+	time_t const now = time(NULL);
+	time_t const maxAge = static_cast<time_t>(family.maxAgeDays) * 24 * 60 * 60;
+
+	for(size_t i = 0; i < byAge.size(); ++i)
+	{
+		bool const isTooOld = family.maxAgeDays > 0 && now - byAge[i].mtime > maxAge;
+		bool const isTooBig = family.maxTotalSize > 0 && total > family.maxTotalSize;
+		if(!isTooOld && !isTooBig)
+			break;
+
+		string const path = family.directory + "/" + byAge[i].name;
+		if(std::remove(path.c_str()) != 0 && errno != ENOENT)
+			LogLog::getLogLog()->error("RetentionManager- Cannot delete " + path);
+
+		total -= family.files[byAge[i].name].size;
+		family.files.erase(byAge[i].name);
+	}
+}
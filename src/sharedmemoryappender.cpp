@@ -0,0 +1,480 @@
+// Module:  Log4CPLUS
+// File:    sharedmemoryappender.cpp
+
+#include "log4cplus/sharedmemoryappender.h"
+#include "log4cplus/layout.h"
+#include "log4cplus/loglog.h"
+#include "log4cplus/property.h"
+#include "log4cplus/loggingevent.h"
+#include "log4cplus/stringhelper.h"
+
+#include <algorithm>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+
+#ifndef _MSC_VER
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+#ifndef _MSC_VER
+
+// Shared memory objects are files in /dev/shm on Linux; opening them
+// directly does the same as shm_open() without requiring librt.
+static const char* const SHM_DIRECTORY = "/dev/shm/";
+
+static uint32_t const SHM_RING_MAGIC = 0x4c344352;	// "L4CR"
+static uint32_t const SHM_RING_VERSION = 1;
+
+//! LogLevel of the records that fill up the end of the ring.
+static int32_t const PADDING_RECORD = -2;
+
+static unsigned long const MINIMUM_RING_SIZE = 4096;
+
+#endif
+
+
+namespace log4cplus {
+
+/**
+* Start of the shared memory object; the ring data follows. Positions
+* are byte counters that only grow, the offset in the ring is the
+* position modulo the capacity. Only the writer moves writePos and only
+* the collector moves readPos.
+*/
+struct ShmRingHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t capacity;
+	int32_t pid;
+	char pad0[44];
+	volatile AtomicInt64 writePos;
+	char pad1[56];
+	volatile AtomicInt64 readPos;
+	char pad2[56];
+	volatile AtomicInt64 dropped;
+	volatile AtomicInt closed;
+};
+
+}
+
+
+#ifndef _MSC_VER
+
+//! Every record starts on an 8 byte boundary with this header, followed
+//! by the logger name and the formatted message.
+struct ShmRecordHeader
+{
+	uint32_t size;			// whole record, padded to a multiple of 8
+	int32_t logLevel;
+	int64_t seconds;
+	int32_t microseconds;
+	uint32_t loggerLength;
+	uint32_t messageLength;
+	uint32_t reserved;
+};
+
+
+static char* ringData(ShmRingHeader* header)
+{
+	return reinterpret_cast<char*>(header) + sizeof(ShmRingHeader);
+}
+
+
+static unsigned long roundUpToPowerOfTwo(unsigned long value)
+{
+	unsigned long result = MINIMUM_RING_SIZE;
+	while(result < value)
+		result <<= 1;
+	return result;
+}
+
+
+static bool isProcessAlive(int pid)
+{
+	return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SharedMemoryAppender
+///////////////////////////////////////////////////////////////////////////////
+
+SharedMemoryAppender::SharedMemoryAppender(const string& name, unsigned long size)
+	: _ring(0), _mappedSize(0), _dropped(0)
+{
+	init(name, size);
+}
+
+
+SharedMemoryAppender::SharedMemoryAppender(const Properties& properties)
+	: Appender(properties), _ring(0), _mappedSize(0), _dropped(0)
+{
+	unsigned long size = 1024 * 1024;
+	properties.getULong(size, "Size");
+
+	init(properties.getProperty("Name", "default"), size);
+}
+
+
+void SharedMemoryAppender::init(const string& name, unsigned long size)
+{
+#ifdef _MSC_VER
+	(void) name;
+	(void) size;
+	getErrorHandler()->error("SharedMemoryAppender- Not supported on this platform");
+	_isClosed = true;
+#else
+	// Appenders replaced by a reconfiguration live on for a moment next
+	// to their successor, so every instance gets its own ring.
+	static volatile AtomicInt s_sequence = 0;
+
+	ostringstream oss;
+	oss << "log4cplus." << name << "." << getpid() << "." << atomicIncrement(&s_sequence);
+	_shmName = oss.str();
+
+	unsigned long const capacity = roundUpToPowerOfTwo(size);
+	string const path = SHM_DIRECTORY + _shmName;
+
+	int const fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	if(fd < 0)
+	{
+		getErrorHandler()->error("SharedMemoryAppender- Cannot create " + path);
+		_isClosed = true;
+		return;
+	}
+
+	_mappedSize = sizeof(ShmRingHeader) + capacity;
+	void* const mem = ftruncate(fd, _mappedSize) == 0
+		? mmap(0, _mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	::close(fd);
+
+	if(mem == MAP_FAILED)
+	{
+		getErrorHandler()->error("SharedMemoryAppender- Cannot map " + path);
+		unlink(path.c_str());
+		_isClosed = true;
+		return;
+	}
+
+	_ring = static_cast<ShmRingHeader*>(mem);
+	_ring->version = SHM_RING_VERSION;
+	_ring->capacity = capacity;
+	_ring->pid = getpid();
+	_ring->writePos = 0;
+	_ring->readPos = 0;
+	_ring->dropped = 0;
+	_ring->closed = 0;
+
+	// The collector ignores the ring until the magic is in place; the
+	// compare-and-swap is a full barrier ordering it after the rest.
+	atomicCompareExchange(&_ring->closed, 0, 0);
+	_ring->magic = SHM_RING_MAGIC;
+#endif
+}
+
+
+SharedMemoryAppender::~SharedMemoryAppender()
+{
+	destructorImpl();
+}
+
+
+void SharedMemoryAppender::close()
+{
+	MutexLock lock(&_mutex);
+
+#ifndef _MSC_VER
+	if(_ring)
+	{
+		// Lets the collector remove the ring once it has drained it.
+		atomicExchange(&_ring->closed, 1);
+		munmap(_ring, _mappedSize);
+		_ring = 0;
+	}
+#endif
+
+	_isClosed = true;
+}
+
+
+AtomicInt64 SharedMemoryAppender::getDroppedCount() const
+{
+	return atomicLoad64(&_dropped);
+}
+
+
+// This method does not need to be locked since it is called by
+// doAppend() which performs the locking; it makes this appender the
+// only writer of its ring.
+void SharedMemoryAppender::append(const InternalLoggingEvent& loggingEvent)
+{
+#ifdef _MSC_VER
+	(void) loggingEvent;
+#else
+	if(!_ring)
+		return;
+
+	string const& text = formatEvent(loggingEvent);
+
+	// SimpleLayout terminates its output with a NUL.
+	string::size_type const end = text.find_last_not_of('\0');
+	string::size_type const messageSize = end == string::npos ? 0 : end + 1;
+
+	string const& logger = loggingEvent.getLoggerName();
+	uint64_t const capacity = _ring->capacity;
+	uint64_t const recordSize = (sizeof(ShmRecordHeader) + logger.size() + messageSize + 7) & ~uint64_t(7);
+
+	uint64_t writePos = _ring->writePos;
+	uint64_t const readPos = atomicLoad64(&_ring->readPos);
+	uint64_t const offset = writePos & (capacity - 1);
+	uint64_t const contiguous = capacity - offset;
+
+	// A record never wraps; the rest of the ring is skipped instead.
+	uint64_t const needed = recordSize <= contiguous ? recordSize : contiguous + recordSize;
+	if(recordSize > capacity / 2 || writePos - readPos + needed > capacity)
+	{
+		atomicAdd64(&_dropped, 1);
+		atomicAdd64(&_ring->dropped, 1);
+		return;
+	}
+
+	char* const data = ringData(_ring);
+	if(recordSize > contiguous)
+	{
+		ShmRecordHeader* const padding = reinterpret_cast<ShmRecordHeader*>(data + offset);
+		padding->size = static_cast<uint32_t>(contiguous);
+		padding->logLevel = PADDING_RECORD;
+		writePos += contiguous;
+	}
+
+	char* const record = data + (writePos & (capacity - 1));
+	ShmRecordHeader* const header = reinterpret_cast<ShmRecordHeader*>(record);
+	TimeHelper const& timestamp = loggingEvent.getTimestamp();
+	header->size = static_cast<uint32_t>(recordSize);
+	header->logLevel = loggingEvent.getLogLevel();
+	header->seconds = timestamp.sec();
+	header->microseconds = timestamp.usec();
+	header->loggerLength = static_cast<uint32_t>(logger.size());
+	header->messageLength = static_cast<uint32_t>(messageSize);
+	header->reserved = 0;
+	memcpy(record + sizeof(ShmRecordHeader), logger.data(), logger.size());
+	memcpy(record + sizeof(ShmRecordHeader) + logger.size(), text.data(), messageSize);
+
+	// Publishes the record; the store is a full barrier.
+	atomicStore64(&_ring->writePos, writePos + recordSize);
+#endif
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SharedMemoryCollector
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+struct CollectedEvent
+{
+	TimeHelper timestamp;
+	LogLevel logLevel;
+	string logger;
+	string message;
+};
+
+bool earlierEvent(const CollectedEvent* lhs, const CollectedEvent* rhs)
+{
+	return lhs->timestamp < rhs->timestamp;
+}
+
+}
+
+
+SharedMemoryCollector::SharedMemoryCollector(const string& name, SharedAppenderPtr target)
+	: _prefix("log4cplus." + name + "."), _target(target)
+{
+#ifdef _MSC_VER
+	LogLog::getLogLog()->error("SharedMemoryCollector- Not supported on this platform");
+#endif
+}
+
+
+SharedMemoryCollector::~SharedMemoryCollector()
+{
+	for(vector<Ring>::iterator it = _rings.begin(); it != _rings.end(); ++it)
+		detach(*it, false);
+}
+
+
+void SharedMemoryCollector::scanForRings()
+{
+#ifndef _MSC_VER
+	DIR* const dir = opendir(SHM_DIRECTORY);
+	if(!dir)
+		return;
+
+	struct dirent* entry;
+	while((entry = readdir(dir)) != 0)
+	{
+		string const shmName(entry->d_name);
+		if(shmName.compare(0, _prefix.size(), _prefix) != 0)
+			continue;
+
+		bool known = false;
+		for(vector<Ring>::iterator it = _rings.begin(); it != _rings.end() && !known; ++it)
+			known = it->shmName == shmName;
+		if(known)
+			continue;
+
+		string const path = SHM_DIRECTORY + shmName;
+		int const fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+		if(fd < 0)
+			continue;
+
+		struct stat status;
+		void* mem = MAP_FAILED;
+		if(fstat(fd, &status) == 0 && static_cast<size_t>(status.st_size) > sizeof(ShmRingHeader))
+			mem = mmap(0, status.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if(mem == MAP_FAILED)
+			continue;
+
+		ShmRingHeader* const header = static_cast<ShmRingHeader*>(mem);
+		if(header->magic != SHM_RING_MAGIC || header->version != SHM_RING_VERSION
+			|| sizeof(ShmRingHeader) + header->capacity != static_cast<uint64_t>(status.st_size))
+		{
+			// Possibly still being set up by its writer; retried next time.
+			munmap(mem, status.st_size);
+			continue;
+		}
+
+		Ring ring;
+		ring.shmName = shmName;
+		ring.header = header;
+		ring.mappedSize = status.st_size;
+		_rings.push_back(ring);
+	}
+
+	closedir(dir);
+#endif
+}
+
+
+void SharedMemoryCollector::detach(Ring& ring, bool removeShm)
+{
+#ifndef _MSC_VER
+	munmap(ring.header, ring.mappedSize);
+	if(removeShm)
+		unlink((SHM_DIRECTORY + ring.shmName).c_str());
+#else
+	(void) ring;
+	(void) removeShm;
+#endif
+}
+
+
+size_t SharedMemoryCollector::poll()
+{
+	size_t forwarded = 0;
+
+#ifndef _MSC_VER
+	scanForRings();
+
+	vector<CollectedEvent> events;
+	vector<uint64_t> readPositions(_rings.size());
+
+	for(size_t i = 0; i < _rings.size(); ++i)
+	{
+		ShmRingHeader* const header = _rings[i].header;
+		uint64_t const capacity = header->capacity;
+		uint64_t readPos = header->readPos;
+		uint64_t const writePos = atomicLoad64(&header->writePos);
+		char const* const data = ringData(header);
+
+		while(readPos < writePos)
+		{
+			ShmRecordHeader const* const record = reinterpret_cast<ShmRecordHeader const*>(data + (readPos & (capacity - 1)));
+			uint64_t const size = record->size;
+			if(size < sizeof(uint64_t) || size > writePos - readPos
+				|| (record->logLevel != PADDING_RECORD
+					&& sizeof(ShmRecordHeader) + static_cast<uint64_t>(record->loggerLength) + record->messageLength > size))
+			{
+				LogLog::getLogLog()->error("SharedMemoryCollector- Corrupt ring " + _rings[i].shmName);
+				readPos = writePos;
+				break;
+			}
+
+			if(record->logLevel != PADDING_RECORD)
+			{
+				char const* const text = reinterpret_cast<char const*>(record) + sizeof(ShmRecordHeader);
+				events.push_back(CollectedEvent());
+				CollectedEvent& event = events.back();
+				event.timestamp = TimeHelper(static_cast<time_t>(record->seconds), record->microseconds);
+				event.logLevel = static_cast<LogLevel>(record->logLevel);
+				event.logger.assign(text, record->loggerLength);
+				event.message.assign(text + record->loggerLength, record->messageLength);
+			}
+			readPos += size;
+		}
+		readPositions[i] = readPos;
+	}
+
+	// Every ring is in time order already; a stable sort merges them.
+	vector<const CollectedEvent*> ordered;
+	ordered.reserve(events.size());
+	for(vector<CollectedEvent>::const_iterator it = events.begin(); it != events.end(); ++it)
+		ordered.push_back(&*it);
+	std::stable_sort(ordered.begin(), ordered.end(), earlierEvent);
+
+	for(vector<const CollectedEvent*>::const_iterator it = ordered.begin(); it != ordered.end(); ++it)
+	{
+		InternalLoggingEvent event((*it)->logger, (*it)->logLevel, (*it)->message, (*it)->timestamp);
+		_target->doAppend(event);
+		++forwarded;
+	}
+
+	// Hand the space back to the writers, then drop finished rings.
+	vector<Ring>::iterator ring = _rings.begin();
+	for(size_t i = 0; i < readPositions.size(); ++i)
+	{
+		ShmRingHeader* const header = ring->header;
+		atomicStore64(&header->readPos, readPositions[i]);
+
+		bool const drained = readPositions[i] == static_cast<uint64_t>(atomicLoad64(&header->writePos));
+		if(drained && (header->closed != 0 || !isProcessAlive(header->pid)))
+		{
+			detach(*ring, true);
+			ring = _rings.erase(ring);
+		}
+		else
+			++ring;
+	}
+#endif
+
+	return forwarded;
+}
+
+
+AtomicInt64 SharedMemoryCollector::getDroppedCount() const
+{
+	AtomicInt64 dropped = 0;
+	for(vector<Ring>::const_iterator it = _rings.begin(); it != _rings.end(); ++it)
+		dropped += atomicLoad64(&it->header->dropped);
+	return dropped;
+}
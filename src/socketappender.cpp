@@ -0,0 +1,532 @@
+// Module:  Log4CPLUS
+// File:    socketappender.cpp
+
+#include "log4cplus/socketappender.h"
+#include "log4cplus/layout.h"
+#include "log4cplus/loglog.h"
+#include "log4cplus/property.h"
+#include "log4cplus/loggingevent.h"
+#include "log4cplus/stringhelper.h"
+
+#include <cstring>
+
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 14))
+#define LOG4CPLUS_HAVE_SENDMMSG
+#endif
+
+
+using namespace std;
+using namespace log4cplus;
+
+
+#ifdef _MSC_VER
+static SOCKET const INVALID_SOCKET_VALUE = INVALID_SOCKET;
+#else
+static int const INVALID_SOCKET_VALUE = -1;
+#endif
+
+//! Most events handed to the kernel by one call.
+static unsigned int const MAX_BATCH_SIZE = 1024;
+
+
+struct SyslogFacility
+{
+	const char* name;
+	int code;
+};
+
+static SyslogFacility const s_facilities[] =
+{
+	{ "kern", 0 }, { "user", 1 }, { "mail", 2 }, { "daemon", 3 },
+	{ "auth", 4 }, { "syslog", 5 }, { "lpr", 6 }, { "news", 7 },
+	{ "uucp", 8 }, { "cron", 9 }, { "authpriv", 10 }, { "ftp", 11 },
+	{ "local0", 16 }, { "local1", 17 }, { "local2", 18 }, { "local3", 19 },
+	{ "local4", 20 }, { "local5", 21 }, { "local6", 22 }, { "local7", 23 }
+};
+
+
+static int facilityFromString(const string& name)
+{
+	for(size_t i = 0; i < sizeof(s_facilities) / sizeof(s_facilities[0]); ++i)
+	{
+		if(name == s_facilities[i].name)
+			return s_facilities[i].code;
+	}
+	return -1;
+}
+
+
+//! Maps a LogLevel to a syslog severity.
+static int syslogSeverity(LogLevel ll)
+{
+	if(ll >= FATAL_LOG_LEVEL)
+		return 2;	// critical
+	else if(ll >= ERROR_LOG_LEVEL)
+		return 3;	// error
+	else if(ll >= INFO_LOG_LEVEL)
+		return 6;	// informational
+	return 7;		// debug
+}
+
+
+SocketAppender::SocketAppender(Protocol protocol, const string& address, unsigned short port)
+	: _protocol(protocol)
+	, _path(protocol == UDP ? string() : address)
+	, _host(protocol == UDP ? address : string())
+	, _port(port)
+	, _facility(-1)
+	, _batchSize(64)
+	, _queueLimit(10000)
+	, _reopenDelay(1)
+	, _maxReopenDelay(60)
+	, _queueMutex("SocketAppender")
+	, _stopping(0)
+	, _dropped(0)
+	, _socket(INVALID_SOCKET_VALUE)
+	, _currentDelay(0)
+{
+	init();
+}
+
+
+SocketAppender::SocketAppender(const Properties& properties)
+	: Appender(properties)
+	, _protocol(UNIX_DGRAM)
+	, _path(properties.getProperty("Path", "/dev/log"))
+	, _host(properties.getProperty("Host", "127.0.0.1"))
+	, _port(514)
+	, _facility(-1)
+	, _ident(properties.getProperty("Ident"))
+	, _batchSize(64)
+	, _queueLimit(10000)
+	, _reopenDelay(1)
+	, _maxReopenDelay(60)
+	, _queueMutex("SocketAppender")
+	, _stopping(0)
+	, _dropped(0)
+	, _socket(INVALID_SOCKET_VALUE)
+	, _currentDelay(0)
+{
+	string const protocol = properties.getProperty("Protocol", "unix-dgram");
+	if(protocol == "unix-stream")
+		_protocol = UNIX_STREAM;
+	else if(protocol == "udp")
+		_protocol = UDP;
+	else if(protocol != "unix-dgram")
+		LogLog::getLogLog()->error("SocketAppender- Unknown Protocol " + protocol + ", using unix-dgram");
+
+	unsigned port = _port;
+	if(properties.getUInt(port, "Port"))
+		_port = static_cast<unsigned short>(port);
+
+	if(properties.exists("Facility"))
+	{
+		_facility = facilityFromString(properties.getProperty("Facility"));
+		if(_facility < 0)
+			LogLog::getLogLog()->error("SocketAppender- Unknown Facility " + properties.getProperty("Facility"));
+	}
+
+	properties.getUInt(_batchSize, "BatchSize");
+	properties.getUInt(_queueLimit, "QueueLimit");
+	properties.getInt(_reopenDelay, "ReopenDelay");
+	properties.getInt(_maxReopenDelay, "MaxReopenDelay");
+
+	init();
+}
+
+
+void SocketAppender::init()
+{
+	if(_batchSize == 0)
+		_batchSize = 1;
+	else if(_batchSize > MAX_BATCH_SIZE)
+		_batchSize = MAX_BATCH_SIZE;
+
+	if(_queueLimit == 0)
+		_queueLimit = 1;
+
+	if(_reopenDelay < 0)
+		_reopenDelay = 0;
+
+	if(_maxReopenDelay < _reopenDelay)
+		_maxReopenDelay = _reopenDelay;
+
+#ifdef _MSC_VER
+	if(_protocol != UDP)
+	{
+		getErrorHandler()->error("SocketAppender- Unix domain sockets are not supported on this platform");
+		_isClosed = true;
+		return;
+	}
+
+	WSADATA wsaData;
+	if(WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		getErrorHandler()->error("SocketAppender- WSAStartup() failed");
+		_isClosed = true;
+		return;
+	}
+#endif
+
+	if(!start())
+		_isClosed = true;
+}
+
+
+SocketAppender::~SocketAppender()
+{
+	destructorImpl();
+}
+
+
+void SocketAppender::close()
+{
+	MutexLock lock(&_mutex);
+
+	if(isStarted())
+	{
+		// The sender thread makes a last attempt to send the queue.
+		atomicExchange(&_stopping, 1);
+		_wakeup.signal();
+		join();
+
+#ifdef _MSC_VER
+		WSACleanup();
+#endif
+	}
+
+	_isClosed = true;
+}
+
+
+AtomicInt64 SocketAppender::getDroppedCount() const
+{
+	return atomicLoad64(&_dropped);
+}
+
+
+// This method does not need to be locked since it is called by
+// doAppend() which performs the locking
+void SocketAppender::append(const InternalLoggingEvent& loggingEvent)
+{
+	string message;
+	if(_facility >= 0)
+	{
+		message += '<';
+		appendIntegerToString(message, _facility * 8 + syslogSeverity(loggingEvent.getLogLevel()));
+		message += '>';
+		if(!_ident.empty())
+		{
+			message += _ident;
+			message += ": ";
+		}
+	}
+
+	string const& text = formatEvent(loggingEvent);
+	string::size_type const end = text.find_last_not_of(string("\n\r\0", 3));
+	message.append(text, 0, end == string::npos ? 0 : end + 1);
+	if(_protocol == UNIX_STREAM)
+		message += '\n';
+
+	{
+		MutexLock lock(&_queueMutex);
+		if(_queue.size() >= _queueLimit)
+		{
+			atomicAdd64(&_dropped, 1);
+			return;
+		}
+		_queue.push_back(string());
+		_queue.back().swap(message);
+	}
+
+	_wakeup.signal();
+}
+
+
+void SocketAppender::run()
+{
+	vector<string> pending;
+	vector<string> incoming;
+
+	for(;;)
+	{
+		unsigned long waitMillis = 1000;
+		if(!pending.empty() && _socket == INVALID_SOCKET_VALUE)
+		{
+			TimeHelper const now = TimeHelper::gettimeofday();
+			TimeHelper const diff = _reconnectTime > now ? _reconnectTime - now : TimeHelper();
+			waitMillis = static_cast<unsigned long>(diff.sec() * 1000 + diff.usec() / 1000);
+		}
+
+		_wakeup.timedWait(waitMillis);
+		bool const stopping = _stopping != 0;
+
+		{
+			MutexLock lock(&_queueMutex);
+			_wakeup.reset();
+			incoming.swap(_queue);
+		}
+
+		if(pending.empty())
+			pending.swap(incoming);
+		else
+		{
+			pending.insert(pending.end(), incoming.begin(), incoming.end());
+			incoming.clear();
+		}
+
+		// Keep the backlog bounded while the peer is away.
+		if(pending.size() > _queueLimit)
+			dropOldest(pending);
+
+		if(!pending.empty())
+		{
+			if(_socket != INVALID_SOCKET_VALUE || ((stopping || TimeHelper::gettimeofday() >= _reconnectTime) && connectSocket()))
+			{
+				if(!sendPending(pending))
+					scheduleReconnect();
+			}
+		}
+
+		if(stopping)
+			break;
+	}
+
+	if(!pending.empty())
+		atomicAdd64(&_dropped, pending.size());
+
+	closeSocket();
+}
+
+
+void SocketAppender::dropOldest(vector<string>& pending)
+{
+	size_t const excess = pending.size() - _queueLimit;
+	pending.erase(pending.begin(), pending.begin() + excess);
+	atomicAdd64(&_dropped, excess);
+}
+
+
+bool SocketAppender::connectSocket()
+{
+#ifdef _MSC_VER
+	SOCKET const fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if(fd == INVALID_SOCKET)
+	{
+		scheduleReconnect();
+		return false;
+	}
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(_port);
+	addr.sin_addr.s_addr = inet_addr(_host.c_str());
+	if(connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+	{
+		closesocket(fd);
+		scheduleReconnect();
+		return false;
+	}
+#else
+	int fd = -1;
+	int ret = -1;
+	if(_protocol == UDP)
+	{
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons(_port);
+		if(inet_aton(_host.c_str(), &addr.sin_addr) == 0)
+		{
+			getErrorHandler()->error("SocketAppender- Invalid Host " + _host);
+			scheduleReconnect();
+			return false;
+		}
+
+		fd = socket(AF_INET, SOCK_DGRAM, 0);
+		if(fd >= 0)
+			ret = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+	}
+	else
+	{
+		struct sockaddr_un addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if(_path.size() >= sizeof(addr.sun_path))
+		{
+			getErrorHandler()->error("SocketAppender- Path too long: " + _path);
+			scheduleReconnect();
+			return false;
+		}
+		strcpy(addr.sun_path, _path.c_str());
+
+		fd = socket(AF_UNIX, _protocol == UNIX_STREAM ? SOCK_STREAM : SOCK_DGRAM, 0);
+		if(fd >= 0)
+			ret = connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+	}
+
+	if(fd < 0 || ret != 0)
+	{
+		if(fd >= 0)
+			::close(fd);
+		scheduleReconnect();
+		return false;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+#endif
+
+	_socket = fd;
+	_currentDelay = 0;
+	getErrorHandler()->reset();
+	return true;
+}
+
+
+void SocketAppender::closeSocket()
+{
+	if(_socket == INVALID_SOCKET_VALUE)
+		return;
+
+#ifdef _MSC_VER
+	closesocket(_socket);
+#else
+	::close(_socket);
+#endif
+	_socket = INVALID_SOCKET_VALUE;
+}
+
+
+void SocketAppender::scheduleReconnect()
+{
+	closeSocket();
+
+	// Double the delay on every failure in a row, like a FileAppender
+	// waiting ReopenDelay seconds before it reopens its file.
+	if(_currentDelay == 0)
+		_currentDelay = _reopenDelay;
+	else
+		_currentDelay = _currentDelay * 2 > _maxReopenDelay ? _maxReopenDelay : _currentDelay * 2;
+
+	_reconnectTime = TimeHelper::gettimeofday() + TimeHelper(_currentDelay);
+	getErrorHandler()->error("SocketAppender- Cannot send to " + (_protocol == UDP ? _host : _path));
+}
+
+
+bool SocketAppender::sendPending(vector<string>& pending)
+{
+	size_t sent = 0;
+	bool ok = true;
+
+	while(sent < pending.size())
+	{
+#ifdef _MSC_VER
+		if(send(_socket, pending[sent].data(), static_cast<int>(pending[sent].size()), 0) < 0)
+		{
+			if(WSAGetLastError() == WSAEMSGSIZE)
+			{
+				atomicAdd64(&_dropped, 1);
+				++sent;
+				continue;
+			}
+			ok = false;
+			break;
+		}
+		++sent;
+#else
+		size_t const count = pending.size() - sent < _batchSize ? pending.size() - sent : _batchSize;
+
+		if(_protocol == UNIX_STREAM)
+		{
+			// One gathering write for the whole batch; a partial write
+			// leaves the unsent tail of the event at the front.
+			struct iovec iov[MAX_BATCH_SIZE];
+			for(size_t i = 0; i < count; ++i)
+			{
+				iov[i].iov_base = const_cast<char*>(pending[sent + i].data());
+				iov[i].iov_len = pending[sent + i].size();
+			}
+
+			struct msghdr msg;
+			memset(&msg, 0, sizeof(msg));
+			msg.msg_iov = iov;
+			msg.msg_iovlen = count;
+
+			ssize_t written = sendmsg(_socket, &msg, MSG_NOSIGNAL);
+			if(written < 0)
+			{
+				if(errno == EINTR)
+					continue;
+				ok = false;
+				break;
+			}
+
+			while(written > 0 && static_cast<size_t>(written) >= pending[sent].size())
+			{
+				written -= pending[sent].size();
+				++sent;
+			}
+			if(written > 0)
+				pending[sent].erase(0, written);
+		}
+		else
+		{
+#ifdef LOG4CPLUS_HAVE_SENDMMSG
+			struct iovec iov[MAX_BATCH_SIZE];
+			struct mmsghdr msgs[MAX_BATCH_SIZE];
+			memset(msgs, 0, count * sizeof(msgs[0]));
+			for(size_t i = 0; i < count; ++i)
+			{
+				iov[i].iov_base = const_cast<char*>(pending[sent + i].data());
+				iov[i].iov_len = pending[sent + i].size();
+				msgs[i].msg_hdr.msg_iov = &iov[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			int const ret = sendmmsg(_socket, msgs, count, 0);
+			if(ret > 0)
+			{
+				sent += ret;
+				continue;
+			}
+#else
+			ssize_t const ret = send(_socket, pending[sent].data(), pending[sent].size(), 0);
+			if(ret >= 0)
+			{
+				++sent;
+				continue;
+			}
+#endif
+			if(errno == EINTR)
+				continue;
+
+			if(errno == EMSGSIZE)
+			{
+				// Too large to ever be sent as one datagram.
+				atomicAdd64(&_dropped, 1);
+				++sent;
+				continue;
+			}
+
+			ok = false;
+			break;
+		}
+#endif
+	}
+
+	pending.erase(pending.begin(), pending.begin() + sent);
+	return ok;
+}
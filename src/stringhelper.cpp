@@ -8,6 +8,11 @@
 #include <cassert>
 #include <limits> 
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOG4CPLUS_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "log4cplus/stringhelper.h"
 #include "log4cplus/loggingevent.h"
 
@@ -112,6 +117,32 @@ string log4cplus::convertIntegerToString(int intValue)
 	return result;
 }
 
+void log4cplus::appendUnsignedToString(string& result, unsigned long long value)
+{
+	char digits[24];
+	char* it = digits + sizeof(digits);
+	do
+	{
+		*--it = static_cast<char>('0' + value % 10);
+		value /= 10;
+	}
+	while(value != 0);
+
+	result.append(it, digits + sizeof(digits) - it);
+}
+
+void log4cplus::appendIntegerToString(string& result, long long value)
+{
+	if(value < 0)
+	{
+		result += '-';
+		// Negate in unsigned arithmetic so that the minimum does not overflow.
+		appendUnsignedToString(result, 0ULL - static_cast<unsigned long long>(value));
+	}
+	else
+		appendUnsignedToString(result, static_cast<unsigned long long>(value));
+}
+
 void log4cplus::join(string& result, Iterator start, Iterator last, string const& sep)
 {
 	if(start != last)
@@ -122,4 +153,131 @@ void log4cplus::join(string& result, Iterator start, Iterator last, string const
 		result += sep;
 		result += *start;
 	}
-}
\ No newline at end of file
+}
+
+// Escape for every byte in a JSON string: 0 copies the byte, 'u' writes
+// \u00XX and anything else is written after a backslash.
+static char const s_jsonEscapes[256] =
+{
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+	'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+	0,   0,   '"', 0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+	0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   '\\',0,   0,   0
+	// The remaining bytes are zero-initialised.
+};
+
+
+void log4cplus::appendJsonEscaped(string& result, const char* s, size_t length)
+{
+	static char const hexDigits[] = "0123456789abcdef";
+
+	char const* const end = s + length;
+	char const* run = s;
+	for(char const* p = s; p != end; ++p)
+	{
+		char const escape = s_jsonEscapes[static_cast<unsigned char>(*p)];
+		if(escape == 0)
+			continue;
+
+		result.append(run, p - run);
+		if(escape == 'u')
+		{
+			char const c = *p;
+			char const sequence[6] = { '\\', 'u', '0', '0', hexDigits[(c >> 4) & 0xf], hexDigits[c & 0xf] };
+			result.append(sequence, sizeof(sequence));
+		}
+		else
+		{
+			char const sequence[2] = { '\\', escape };
+			result.append(sequence, sizeof(sequence));
+		}
+		run = p + 1;
+	}
+
+	result.append(run, end - run);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// StringSearcher
+///////////////////////////////////////////////////////////////////////////////
+
+StringSearcher::StringSearcher(const string& needle) : _needle(needle) {}
+
+
+#ifdef LOG4CPLUS_HAVE_SSE2
+static inline unsigned int countTrailingZeros(unsigned int mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+
+size_t StringSearcher::find(const char* haystack, size_t length) const
+{
+	size_t const m = _needle.size();
+	if(m == 0)
+		return 0;
+	if(m > length)
+		return string::npos;
+
+	char const* const needle = _needle.data();
+	if(m == 1)
+	{
+		void const* hit = std::memchr(haystack, needle[0], length);
+		return hit ? static_cast<char const*>(hit) - haystack : string::npos;
+	}
+
+	size_t const lastStart = length - m;	// last position a match may begin at
+	size_t i = 0;
+
+#ifdef LOG4CPLUS_HAVE_SSE2
+	__m128i const first = _mm_set1_epi8(needle[0]);
+	__m128i const last = _mm_set1_epi8(needle[m - 1]);
+
+	// Positions i..i+31 are candidates when both their first and their
+	// last byte match; two 16 byte blocks are tested per iteration.
+	for(; i + 31 <= lastStart; i += 32)
+	{
+		char const* const p = haystack + i;
+		__m128i const eq0 = _mm_and_si128(
+			_mm_cmpeq_epi8(first, _mm_loadu_si128(reinterpret_cast<__m128i const*>(p))),
+			_mm_cmpeq_epi8(last, _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + m - 1))));
+		__m128i const eq1 = _mm_and_si128(
+			_mm_cmpeq_epi8(first, _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16))),
+			_mm_cmpeq_epi8(last, _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 16 + m - 1))));
+		unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(eq0))
+			| (static_cast<unsigned int>(_mm_movemask_epi8(eq1)) << 16);
+
+		while(mask != 0)
+		{
+			unsigned int const bit = countTrailingZeros(mask);
+			if(std::memcmp(haystack + i + bit + 1, needle + 1, m - 2) == 0)
+				return i + bit;
+			mask &= mask - 1;
+		}
+	}
+#endif
+
+	while(i <= lastStart)
+	{
+		void const* hit = std::memchr(haystack + i, needle[0], lastStart - i + 1);
+		if(!hit)
+			break;
+
+		i = static_cast<char const*>(hit) - haystack;
+		if(std::memcmp(haystack + i + 1, needle + 1, m - 1) == 0)
+			return i;
+		++i;
+	}
+
+	return string::npos;
+}
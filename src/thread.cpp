@@ -0,0 +1,192 @@
+// Module:  Log4CPLUS
+// File:    thread.cpp
+
+#include "log4cplus/thread.h"
+#include "log4cplus/loglog.h"
+
+#ifdef _MSC_VER
+#include <process.h>
+#else
+#include <sys/time.h>
+#include <errno.h>
+#endif
+
+
+using namespace log4cplus;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Thread
+///////////////////////////////////////////////////////////////////////////////
+
+Thread::Thread() : _handle(), _isStarted(false) {}
+
+
+Thread::~Thread()
+{
+#ifdef _MSC_VER
+	if(_isStarted)
+		CloseHandle(_handle);
+#endif
+}
+
+
+bool Thread::start()
+{
+	if(_isStarted)
+		return true;
+
+#ifdef _MSC_VER
+	uintptr_t const handle = _beginthreadex(0, 0, threadProc, this, 0, 0);
+	if(handle == 0)
+	{
+		LogLog::getLogLog()->error("Thread::start()- _beginthreadex() failed");
+		return false;
+	}
+	_handle = reinterpret_cast<HANDLE>(handle);
+#else
+	if(pthread_create(&_handle, 0, threadProc, this) != 0)
+	{
+		LogLog::getLogLog()->error("Thread::start()- pthread_create() failed");
+		return false;
+	}
+#endif
+
+	_isStarted = true;
+	return true;
+}
+
+
+void Thread::join()
+{
+	if(!_isStarted)
+		return;
+
+#ifdef _MSC_VER
+	WaitForSingleObject(_handle, INFINITE);
+	CloseHandle(_handle);
+#else
+	pthread_join(_handle, 0);
+#endif
+
+	_isStarted = false;
+}
+
+
+#ifdef _MSC_VER
+unsigned __stdcall Thread::threadProc(void* arg)
+#else
+void* Thread::threadProc(void* arg)
+#endif
+{
+	static_cast<Thread*>(arg)->run();
+	log4cplus::threadCleanup();
+	return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ManualResetEvent
+///////////////////////////////////////////////////////////////////////////////
+
+#ifdef _MSC_VER
+
+ManualResetEvent::ManualResetEvent(bool signalled)
+	: _event(CreateEvent(0, TRUE, signalled ? TRUE : FALSE, 0))
+{
+}
+
+
+ManualResetEvent::~ManualResetEvent()
+{
+	CloseHandle(_event);
+}
+
+
+void ManualResetEvent::signal()
+{
+	SetEvent(_event);
+}
+
+
+void ManualResetEvent::reset()
+{
+	ResetEvent(_event);
+}
+
+
+void ManualResetEvent::wait()
+{
+	WaitForSingleObject(_event, INFINITE);
+}
+
+
+bool ManualResetEvent::timedWait(unsigned long millis)
+{
+	return WaitForSingleObject(_event, millis) == WAIT_OBJECT_0;
+}
+
+#else	//__linux__
+
+ManualResetEvent::ManualResetEvent(bool signalled) : _signalled(signalled)
+{
+	pthread_mutex_init(&_mutex, 0);
+	pthread_cond_init(&_cond, 0);
+}
+
+
+ManualResetEvent::~ManualResetEvent()
+{
+	pthread_cond_destroy(&_cond);
+	pthread_mutex_destroy(&_mutex);
+}
+
+
+void ManualResetEvent::signal()
+{
+	pthread_mutex_lock(&_mutex);
+	_signalled = true;
+	pthread_cond_broadcast(&_cond);
+	pthread_mutex_unlock(&_mutex);
+}
+
+
+void ManualResetEvent::reset()
+{
+	pthread_mutex_lock(&_mutex);
+	_signalled = false;
+	pthread_mutex_unlock(&_mutex);
+}
+
+
+void ManualResetEvent::wait()
+{
+	pthread_mutex_lock(&_mutex);
+	while(!_signalled)
+		pthread_cond_wait(&_cond, &_mutex);
+	pthread_mutex_unlock(&_mutex);
+}
+
+
+bool ManualResetEvent::timedWait(unsigned long millis)
+{
+	struct timeval now;
+	gettimeofday(&now, 0);
+
+	struct timespec deadline;
+	long long const nanos = static_cast<long long>(now.tv_usec) * 1000 
+		+ static_cast<long long>(millis % 1000) * 1000000;
+	deadline.tv_sec = now.tv_sec + millis / 1000 + static_cast<time_t>(nanos / 1000000000);
+	deadline.tv_nsec = static_cast<long>(nanos % 1000000000);
+
+	pthread_mutex_lock(&_mutex);
+	int ret = 0;
+	while(!_signalled && ret != ETIMEDOUT)
+		ret = pthread_cond_timedwait(&_cond, &_mutex, &deadline);
+	bool const signalled = _signalled;
+	pthread_mutex_unlock(&_mutex);
+
+	return signalled;
+}
+
+#endif